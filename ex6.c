@@ -1,71 +1,213 @@
 // include the header file
 #include "ex6.h"
 
+// the buffer every input line is read from
+InputReader input = {NULL, NULL, 0, 0, 0, false, false};
+// the buffer every output goes through (every thread of the server has its own, for its client)
+THREAD_LOCAL OutputBuffer output = {NULL, 0, 0, STDOUT_FILENO, false};
+// the pre-rendered display line of every species
+PokemonLine pokemonLines[POKEDEX_LENGTH];
+// the IDs of all the species, sorted by their names
+int alphabeticalIDs[POKEDEX_LENGTH];
+// the species of every type, as bitmaps like the owners' species bitmaps
+unsigned long long typeMasks[TYPE_COUNT][SPECIES_WORDS];
+// the fight score of every species, in tenths (attack * 1.5 + hp * 1.2, times 10)
+int pokemonScores[POKEDEX_LENGTH];
 // the head of the two-way linked list which stores all the pokedexes
 OwnerNode* ownersHead = NULL;
 // the tail of the two-way linked list
 OwnerNode* ownersTail = NULL;
 // the variable that stores the size of the two-way linked list
 int ownerCount = 0;
+// the owners in the order of the two-way linked list, for access by position
+OwnerTable ownerTable = {NULL, 0};
+// if the two-way linked list is known to be sorted by name
+bool ownersSorted = true;
+// if new owners are inserted at their sorted position instead of at the end
+bool keepOwnersSorted = false;
+// the queue reused by every level-order traversal (of the same thread)
+THREAD_LOCAL PokemonQueue levelQueue = {NULL, 0, 0, 0};
+// the pools every PokemonNode and OwnerNode is allocated from
+ObjectPool pokemonPool = {sizeof(PokemonNode), NULL, NULL, NULL, NULL, PTHREAD_MUTEX_INITIALIZER};
+ObjectPool ownerPool = {sizeof(OwnerNode), NULL, NULL, NULL, NULL, PTHREAD_MUTEX_INITIALIZER};
+// the hash index from owner names to owners
+OwnerIndex ownerIndex = {NULL, 0, 0};
+// the marker of an emptied index slot (only its address is used)
+OwnerNode ownerTombstone;
+// the set of owners of every species
+SpeciesOwners speciesOwners[POKEDEX_LENGTH];
+// the write-ahead journal of every change (closed unless --journal is given)
+Journal journal = {-1, NULL, NULL, 0, 0, 0, 0, FSYNC_BATCH, false};
+// the commands that add, remove or reorder owners hold it exclusively, every other command shares it
+pthread_rwlock_t ownersLock = PTHREAD_RWLOCK_INITIALIZER;
+// guards the species index, which commands on different owners change at the same time
+pthread_mutex_t speciesLock = PTHREAD_MUTEX_INITIALIZER;
+// guards the journal buffer
+pthread_mutex_t journalLock = PTHREAD_MUTEX_INITIALIZER;
+// set by SIGINT or SIGTERM to stop the server
+volatile sig_atomic_t serverStopping = 0;
+// if the commands that read one owner take no locks (--lockfree), reading published versions instead
+bool lockFreeReads = false;
+// the pool every PokedexVersion is allocated from
+ObjectPool versionPool = {sizeof(PokedexVersion), NULL, NULL, NULL, NULL, PTHREAD_MUTEX_INITIALIZER};
+// the current epoch, the records of the readers, and what was retired in each of the last epochs
+unsigned long globalEpoch = 0;
+EpochRecord* epochRecords = NULL;
+LimboList limbo[EPOCH_LISTS];
+// guards the records and the limbo lists
+pthread_mutex_t epochLock = PTHREAD_MUTEX_INITIALIZER;
+// the record of the thread (NULL until its first lock-free read)
+THREAD_LOCAL EpochRecord* epochRecord = NULL;
+// the counter sets of every thread, and the lock that guards the list
+CounterSet* counterSets = NULL;
+pthread_mutex_t counterLock = PTHREAD_MUTEX_INITIALIZER;
+// the counter set of the thread (NULL until its first count)
+THREAD_LOCAL CounterSet* counterSet = NULL;
 
-int main()
+int main(int argc, char* argv[])
 {
-    // get into the main menu
-    mainMenu();
-    // after the user exited the program, free all the allocated data
-    while (ownersHead != NULL)
-        freeOwnerNode(ownersHead);
-    return 0;
-}
-
-char* trim(char* str)
-{
-    // if the string is empty, return the string
-    if (str[0] == '\0')
-        return str;
-
-    int start = 0;
-    // for each space in the start of the string, update the start of the string accordingly
-    while (isspace(str[start]))
-        start++;
-
-    // get the length of the str
-    const int len = strlen(str); // NOLINT(*-narrowing-conversions)
-    // for each space in the end of the string, delete it (switch with NULL)
-    for (int i = len - 1; isspace(str[i]) && i > start; --i)
-        str[i] = '\0';
-
-    // copy the trimmed string into a temp variable
-    char* tmp = malloc((strlen(str + start) + 1) * sizeof(char));
-    // if the allocation has failed, exit the program.
-    if (tmp == NULL)
+    // render the display line of every species once
+    renderPokemonLines();
+    // rank the names of every species once
+    rankPokemonNames();
+    // score every species once
+    computeFightScores();
+    // group the species by type once
+    buildTypeMasks();
+    // map the input if it is a file
+    initInput();
+    // whatever is still buffered is written out, even if the program exits early,
+    // and then the counters are dumped (if EX6_STATS is set), so they include that last write
+    atexit(dumpCountersAtExit);
+    atexit(freeOutput);
+    // read the arguments: --batch runs the commands from the input without any prompts,
+    // --load starts from a snapshot instead of from nothing,
+    // --journal keeps every change in a journal (on top of its own snapshot),
+    // --server serves the commands of many clients over a socket instead of reading the input,
+    // --client sends the input (or a generated load) to a server,
+    // and --bench runs a generated workload (or prints it as a script) and reports how fast it ran
+    bool batch = false;
+    const char* snapshot = NULL;
+    const char* journalPath = NULL;
+    const char* serverPath = NULL;
+    const char* clientPath = NULL;
+    int clients = 0, requests = 0;
+    bool lockFree = false;
+    bool bench = false, script = false, benchOptions = false;
+    BenchConfig benchConfig;
+    initBenchConfig(&benchConfig);
+    FsyncPolicy policy = FSYNC_BATCH;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; ++i)
     {
-        printf("Memory reallocation failed. (trim: tmp)\n");
-        exit(1);
+        if (strcmp(argv[i], "--batch") == 0)
+            batch = true;
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc)
+            snapshot = argv[++i];
+        else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc)
+            journalPath = argv[++i];
+        else if (strcmp(argv[i], "--fsync") == 0 && i + 1 < argc)
+            valid = parseFsyncPolicy(argv[++i], &policy);
+        else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc)
+            serverPath = argv[++i];
+        else if (strcmp(argv[i], "--lockfree") == 0)
+            lockFree = true;
+        else if (strcmp(argv[i], "--client") == 0 && i + 1 < argc)
+            clientPath = argv[++i];
+        else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc)
+            valid = parseIntArg(argv[++i], &clients) && clients > 0;
+        else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc)
+            valid = parseIntArg(argv[++i], &requests) && requests > 0;
+        else if (strcmp(argv[i], "--bench") == 0)
+            bench = true;
+        else if (strcmp(argv[i], "--script") == 0)
+            script = benchOptions = true;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            valid = benchOptions = parseIntArg(argv[++i], &benchConfig.seed) && benchConfig.seed >= 0;
+        else if (strcmp(argv[i], "--owners") == 0 && i + 1 < argc)
+            valid = benchOptions = parseIntArg(argv[++i], &benchConfig.owners) && benchConfig.owners > 0;
+        else if (strcmp(argv[i], "--pokemon") == 0 && i + 1 < argc)
+            valid = benchOptions = parseIntArg(argv[++i], &benchConfig.pokemon) && benchConfig.pokemon >= 0
+                && benchConfig.pokemon <= POKEDEX_LENGTH;
+        else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+            valid = benchOptions = parseIntArg(argv[++i], &benchConfig.operations) && benchConfig.operations >= 0;
+        else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc)
+            valid = benchOptions = parseBenchMix(argv[++i], benchConfig.weights);
+        else if (strcmp(argv[i], "--ids") == 0 && i + 1 < argc)
+            valid = benchOptions = parseBenchIDs(argv[++i], &benchConfig.ids);
+        else
+            valid = false;
     }
-    strcpy(tmp, str + start);
-    // copy the trimmed string back to the original string, but add it in its start.
-    strcpy(str, tmp);
-    // free the temporary allocated string
-    free(tmp);
-
-    // cut the original size of the string to fit exactly the new trimmed string.
-    str = realloc(str, (strlen(str) + 1) * sizeof(char));
-    // if the allocation failed, exit the program
-    if (str == NULL)
+    // the journal replays on top of its own snapshot, so it cannot start from another one,
+    // the server reads no input, the client keeps no owners of its own,
+    // the benchmark generates its own commands, and a merge needs two owners
+    if (!valid || (snapshot != NULL && journalPath != NULL) || (serverPath != NULL && batch)
+        || (clientPath != NULL && (batch || snapshot != NULL || journalPath != NULL || serverPath != NULL))
+        || (clientPath == NULL && (clients > 0 || requests > 0)) || (lockFree && serverPath == NULL)
+        || (bench && (batch || serverPath != NULL || clientPath != NULL)) || (benchOptions && !bench)
+        || (bench && benchConfig.owners < 2 && benchConfig.weights[BENCH_MERGE] > 0))
     {
-        printf("Memory reallocation failed. (trim: str)\n");
+        fprintf(stderr, "Usage: %s [--batch | --server SOCKET [--lockfree]] [--load FILE | --journal FILE [--fsync always|batch|never]]\n"
+                "       %s --client SOCKET [--clients N] [--requests N]\n"
+                "       %s --bench [--seed N] [--owners N] [--pokemon N] [--ops N] [--mix OP=WEIGHT,...]\n"
+                "              [--ids uniform|sequential|skewed] [--script] [--load FILE | --journal FILE]\n",
+                argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    // a client only talks to the server: it forwards the input, or generates a load when asked to
+    if (clientPath != NULL)
+    {
+        const bool sent = clients > 0 || requests > 0
+                              ? runLoadClients(clientPath, clients > 0 ? clients : LOAD_CLIENTS,
+                                               requests > 0 ? requests : LOAD_REQUESTS)
+                              : runClient(clientPath);
+        freeInput();
+        return sent ? 0 : 1;
+    }
+    // a snapshot or a journal that cannot be loaded is fatal at startup
+    if (snapshot != NULL && !loadSnapshot(snapshot, NULL))
+        exit(1);
+    if (journalPath != NULL && !openJournal(journalPath, policy))
         exit(1);
+    // get into the main menu, run the batch or the benchmark, or serve the clients until the server is stopped
+    int status = 0;
+    if (serverPath != NULL)
+    {
+        // the lock-free readers need every owner published before the first client comes
+        lockFreeReads = lockFree;
+        for (int i = 0; i < ownerCount && lockFreeReads; ++i)
+            publishPokedex(ownerTable.owners[i]);
+        status = runServer(serverPath) ? 0 : 1;
     }
+    else if (bench)
+        runBenchmark(&benchConfig, script);
+    else if (batch)
+        runBatch();
+    else
+        mainMenu();
+    // after the user exited the program, free all the allocated data
+    closeJournal();
+    freePokdexes(&ownersHead);
+    freePokemonQueue(&levelQueue);
+    freeInput();
+    return status;
+}
 
-    // return the trimmed string.
+char* trim(char* str)
+{
+    // skip every space in the start of the string
+    while (isspace((unsigned char)*str))
+        str++;
+    // delete every space in the end of the string (switch it with NULL)
+    size_t len = strlen(str);
+    while (len > 0 && isspace((unsigned char)str[len - 1]))
+        str[--len] = '\0';
+    // return the trimmed string, which is inside the original one
     return str;
 }
 
 int readIntSafe(const char* prompt)
 {
-    // the buffer for reading not just one at a time
-    char buffer[DEFAULT_CAPACITY];
     // the value to scan
     int value = 0;
     // if the scan was done successfully
@@ -75,40 +217,33 @@ int readIntSafe(const char* prompt)
     while (!success)
     {
         // prompt the prompt :)
-        printf("%s", prompt);
+        writeOutput(prompt, strlen(prompt));
 
-        // If we fail to read, treat it as invalid
-        if (!fgets(buffer, sizeof(buffer), stdin))
+        // read the next (trimmed) line, straight from the input buffer
+        const char* line = getInputView();
+        // if the input ended, no valid integer will ever come
+        if (input.ended && line[0] == '\0' && input.position == input.size)
         {
-            printf("Invalid input.\n");
-            clearerr(stdin);
-            continue;
+            printOutput("Invalid input.\n");
+            exit(1);
         }
 
-        // 1) Strip any trailing \r or \n
-        //    so "123\r\n" becomes "123"
-        size_t len = strlen(buffer);
-        if (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == '\r'))
-            buffer[--len] = '\0';
-        if (len > 0 && (buffer[len - 1] == '\r' || buffer[len - 1] == '\n'))
-            buffer[--len] = '\0';
-
-        // 2) Check if empty after stripping
-        if (len == 0)
+        // Check if empty after trimming
+        if (line[0] == '\0')
         {
-            printf("Invalid input.\n");
+            printOutput("Invalid input.\n");
             continue;
         }
 
-        // 3) Attempt to parse integer with strtol
+        // Attempt to parse integer with strtol
         char* endptr;
-        value = (int)strtol(buffer, &endptr, 10);
+        value = (int)strtol(line, &endptr, 10);
 
         // If endptr didn't point to the end => leftover chars => invalid
         // or if buffer was something non-numeric
         if (*endptr != '\0')
         {
-            printf("Invalid input.\n");
+            printOutput("Invalid input.\n");
         }
         else
         {
@@ -122,87 +257,255 @@ int readIntSafe(const char* prompt)
 
 const char* getTypeName(const PokemonType type)
 {
+    // the names of the PokemonTypes, in the order of the enum
+    static const char* const typeNames[TYPE_COUNT] = {
+        "GRASS", "FIRE", "WATER", "BUG", "NORMAL", "POISON", "ELECTRIC", "GROUND",
+        "FAIRY", "FIGHTING", "PSYCHIC", "ROCK", "GHOST", "DRAGON", "ICE"
+    };
     // return the name of a PokemonType
-    switch (type)
-    {
-    case GRASS:
-        return "GRASS";
-    case FIRE:
-        return "FIRE";
-    case WATER:
-        return "WATER";
-    case BUG:
-        return "BUG";
-    case NORMAL:
-        return "NORMAL";
-    case POISON:
-        return "POISON";
-    case ELECTRIC:
-        return "ELECTRIC";
-    case GROUND:
-        return "GROUND";
-    case FAIRY:
-        return "FAIRY";
-    case FIGHTING:
-        return "FIGHTING";
-    case PSYCHIC:
-        return "PSYCHIC";
-    case ROCK:
-        return "ROCK";
-    case GHOST:
-        return "GHOST";
-    case DRAGON:
-        return "DRAGON";
-    case ICE:
-        return "ICE";
-    default:
+    if (type < 0 || type >= TYPE_COUNT)
         return "UNKNOWN";
+    return typeNames[type];
+}
+
+void renderPokemonLines(void)
+{
+    // format the display line of every species once
+    for (int i = 0; i < POKEDEX_LENGTH; ++i)
+    {
+        const PokemonData* data = &pokedex[i];
+        pokemonLines[i].length = snprintf(pokemonLines[i].text, POKEMON_LINE_MAX,
+                                          "ID: %d, Name: %s, Type: %s, HP: %d, Attack: %d, Can Evolve: %s\n",
+                                          data->id + 1,
+                                          data->name,
+                                          getTypeName(data->TYPE),
+                                          data->hp,
+                                          data->attack,
+                                          data->CAN_EVOLVE == CAN_EVOLVE ? "Yes" : "No");
     }
 }
 
-char* getDynamicInput()
+void reserveOutput(const size_t length)
 {
-    // the size, capacity of the input
-    size_t size = 0, capacity = DEFAULT_CAPACITY;
-    // allocate space for the input
-    char* input = malloc(capacity);
+    // if there is enough free space, there is nothing to do
+    if (output.size + length <= output.capacity)
+        return;
+    // grow the buffer (at least double it)
+    size_t capacity = output.capacity > 0 ? output.capacity * 2 : OUTPUT_CAPACITY;
+    while (output.size + length > capacity)
+        capacity *= 2;
+    char* grown = realloc(output.data, capacity);
+    // if the allocation has failed, exit the program (the message can not go through the buffer)
+    if (grown == NULL)
+    {
+        fprintf(stderr, "Memory reallocation failed. (reserveOutput: output.data)\n");
+        exit(1);
+    }
+    output.data = grown;
+    output.capacity = capacity;
+}
+
+void writeOutput(const char* data, const size_t length)
+{
+    // make room for the data and append it
+    reserveOutput(length);
+    memcpy(output.data + output.size, data, length);
+    output.size += length;
+}
+
+void printOutput(const char* format, ...)
+{
+    va_list args;
+    // make sure there is some free space, then format into it
+    reserveOutput(DEFAULT_CAPACITY);
+    va_start(args, format);
+    const int length = vsnprintf(output.data + output.size, output.capacity - output.size, format, args);
+    va_end(args);
+    // if the text (and its null char) did not fit, make room for it and format again
+    if ((size_t)length >= output.capacity - output.size)
+    {
+        reserveOutput(length + 1);
+        va_start(args, format);
+        vsnprintf(output.data + output.size, output.capacity - output.size, format, args);
+        va_end(args);
+    }
+    output.size += length;
+}
+
+void flushOutput(void)
+{
+    // the results of the changes are only shown once the changes are in the journal (group commit)
+    commitJournal();
+    // write everything in as few write calls as the system allows (usually one),
+    // or as one frame when it goes to a client of the server (an empty frame would end the reply)
+    if (!output.framed)
+        writeAll(output.fd, output.data, output.size);
+    else if (output.size > 0)
+        writeFrame(output.fd, output.data, output.size);
+    // the buffer is empty again
+    output.size = 0;
+}
+
+bool writeAll(const int fd, const char* data, const size_t length)
+{
+    size_t written = 0;
+    while (written < length)
+    {
+        const ssize_t result = write(fd, data + written, length - written);
+        // retry if interrupted, give up on any other error
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        written += result;
+        addCounter(COUNTER_BYTES_WRITTEN, result);
+    }
+    return true;
+}
+
+void freeOutput(void)
+{
+    // write what is left, then free the buffer
+    flushOutput();
+    free(output.data);
+    output.data = NULL;
+    output.capacity = 0;
+}
+
+char* copyString(const char* str)
+{
+    // allocate space for the string and its null char
+    char* copy = malloc(strlen(str) + 1);
     // in the allocation has failed, exit the program
-    if (input == NULL)
+    if (copy == NULL)
     {
-        printf("Memory allocation failed. (getDynamicInput: input)\n");
+        printOutput("Memory allocation failed. (copyString: copy)\n");
         exit(1);
     }
+    // copy the string
+    strcpy(copy, str);
+    return copy;
+}
+
+void initInput(void)
+{
+    struct stat info;
+    // only a regular file can be mapped
+    if (fstat(STDIN_FILENO, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0)
+        return;
+    // the input starts wherever stdin currently is
+    const off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (offset < 0 || offset >= info.st_size)
+        return;
+    // map a private (copy-on-write) view, so lines can be cut in place
+    void* data = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, STDIN_FILENO, 0);
+    if (data == MAP_FAILED)
+        return;
+    // the whole input is already here, nothing more will be read
+    input.data = data;
+    input.size = info.st_size;
+    input.position = offset;
+    input.mapped = true;
+    addCounter(COUNTER_BYTES_READ, info.st_size - offset);
+    input.ended = true;
+}
+
+void fillInput(void)
+{
+    // move the unfinished line to the start of the buffer
+    if (input.position > 0)
+        memmove(input.data, input.data + input.position, input.size - input.position);
+    input.size -= input.position;
+    input.position = 0;
+    // if the buffer is full, double it (always keeping a spare byte for the last null char)
+    if (input.size + 1 >= input.capacity)
+    {
+        input.capacity = input.capacity > 0 ? input.capacity * 2 : INPUT_BLOCK;
+        input.data = realloc(input.data, input.capacity);
+        // if the allocation has failed, exit the program
+        if (input.data == NULL)
+        {
+            printOutput("Memory reallocation failed. (fillInput: input.data)\n");
+            exit(1);
+        }
+    }
+    // read as much as fits in one call
+    ssize_t result;
+    do
+        result = read(STDIN_FILENO, input.data + input.size, input.capacity - input.size - 1);
+    while (result < 0 && errno == EINTR);
+    // on end of file (or an error), there is nothing more to read
+    if (result <= 0)
+        input.ended = true;
+    else
+    {
+        input.size += result;
+        addCounter(COUNTER_BYTES_READ, result);
+    }
+}
 
-    // the scanned char
-    int c;
-    // while the line has not been ended
-    while ((c = getchar()) != '\n' && c != EOF)
+char* readLine(void)
+{
+    while (true)
     {
-        // if the size exceeds the capacity
-        if (size + 1 >= capacity)
+        // look for the end of the next line in what is already buffered
+        char* start = input.data + input.position;
+        char* newline = input.data == NULL ? NULL : memchr(start, '\n', input.size - input.position);
+        if (newline != NULL)
         {
-            // increase the capacity
-            capacity *= 2;
-            // reallocate space for the input
-            input = realloc(input, capacity);
-            // if the reallocation has failed, exit the program.
-            if (input == NULL)
+            // cut the line in place, and continue after it next time
+            *newline = '\0';
+            input.position = newline - input.data + 1;
+            return trim(start);
+        }
+        // if the input ended, whatever is left is the last line (if anything is left)
+        if (input.ended)
+        {
+            if (input.position == input.size)
+                return NULL;
+            const size_t length = input.size - input.position;
+            input.position = input.size;
+            // a mapping has no spare byte for the null char, so the last line is copied once
+            if (input.mapped)
             {
-                printf("Memory reallocation failed. (getDynamicInput: tmp)\n");
-                exit(1);
+                free(input.tail);
+                input.tail = malloc(length + 1);
+                // if the allocation has failed, exit the program
+                if (input.tail == NULL)
+                {
+                    printOutput("Memory allocation failed. (readLine: input.tail)\n");
+                    exit(1);
+                }
+                memcpy(input.tail, start, length);
+                start = input.tail;
             }
+            start[length] = '\0';
+            return trim(start);
         }
-        // add the scanned char to the input
-        input[size++] = (char)c;
+        // else, read more
+        fillInput();
     }
-    // after reading the input, add the null char in the end
-    input[size] = '\0';
+}
 
-    // trim any leading/trailing whitespace or carriage returns
-    input = trim(input);
+char* getInputView(void)
+{
+    // whatever was asked must be visible before we wait for the input
+    flushOutput();
+    // read the next line (an ended input gives an empty line)
+    char* line = readLine();
+    return line != NULL ? line : "";
+}
 
-    // return the scanned string
-    return input;
+void freeInput(void)
+{
+    // unmap or free the buffer
+    if (input.mapped)
+        munmap(input.data, input.size);
+    else
+        free(input.data);
+    free(input.tail);
+    input.data = input.tail = NULL;
+    input.size = input.capacity = input.position = 0;
 }
 
 void printPokemonNode(const PokemonNode* node)
@@ -210,14 +513,23 @@ void printPokemonNode(const PokemonNode* node)
     // if the PokemonNode does not exist
     if (node == NULL)
         return;
-    // else, print all of its details
-    printf("ID: %d, Name: %s, Type: %s, HP: %d, Attack: %d, Can Evolve: %s\n",
-           node->data->id + 1,
-           node->data->name,
-           getTypeName(node->data->TYPE),
-           node->data->hp,
-           node->data->attack,
-           node->data->CAN_EVOLVE == CAN_EVOLVE ? "Yes" : "No");
+    // else, copy its pre-rendered line with all of its details
+    const PokemonLine* line = &pokemonLines[node->data->id];
+    writeOutput(line->text, line->length);
+}
+
+void rankPokemonNames(void)
+{
+    // the rank of a name is the number of names that come before it (the names are unique)
+    for (int i = 0; i < POKEDEX_LENGTH; ++i)
+    {
+        int rank = 0;
+        for (int j = 0; j < POKEDEX_LENGTH; ++j)
+            if (strcmp(pokedex[j].name, pokedex[i].name) < 0)
+                rank++;
+        // place the ID in its rank
+        alphabeticalIDs[rank] = i;
+    }
 }
 
 void displayPokemon(const OwnerNode* owner)
@@ -225,21 +537,36 @@ void displayPokemon(const OwnerNode* owner)
     // if there is no Pokemon in the Pokedex, inform the user and return
     if (owner->pokedexRoot == NULL)
     {
-        printf("Pokedex is empty.\n");
+        printOutput("Pokedex is empty.\n");
         return;
     }
 
     // print the menu
-    printf("Display:\n");
-    printf("1. BFS (Level-Order)\n");
-    printf("2. Pre-Order\n");
-    printf("3. In-Order\n");
-    printf("4. Post-Order\n");
-    printf("5. Alphabetical (by name)\n");
-
-    // read the chosen option
+    printOutput("Display:\n");
+    printOutput("1. BFS (Level-Order)\n");
+    printOutput("2. Pre-Order\n");
+    printOutput("3. In-Order\n");
+    printOutput("4. Post-Order\n");
+    printOutput("5. Alphabetical (by name)\n");
+    printOutput("6. By Type\n");
+
+    // read the chosen option, and display the Pokedex accordingly
+    // (only the menu asks for the types, batch commands give them with "display <owner> type")
     const int choice = readIntSafe("Your choice: ");
+    if (choice == 6)
+        displayPokemonByTypesMenu(owner);
+    else
+        displayPokemonByChoice(owner, choice);
+}
 
+void displayPokemonByChoice(const OwnerNode* owner, const int choice)
+{
+    // if there is no Pokemon in the Pokedex, inform the user and return
+    if (owner->pokedexRoot == NULL)
+    {
+        printOutput("Pokedex is empty.\n");
+        return;
+    }
     // do the chosen action accordingly
     switch (choice)
     {
@@ -256,36 +583,85 @@ void displayPokemon(const OwnerNode* owner)
         displayPostOrder(owner->pokedexRoot);
         break;
     case 5:
-        displayAlphabetical(owner->pokedexRoot);
+        displayAlphabetical(owner);
         break;
     default: // if the chosen action is not valid, inform the user and return
-        printf("Invalid choice.\n");
+        printOutput("Invalid choice.\n");
     }
 }
 
-void displayAlphabetical(PokemonNode* root)
+void buildTypeMasks(void)
 {
-    // create an array for all the PokemonNodes in the BT
-    NodeArray na;
-    // init the array to a default capacity
-    initNodeArray(&na, DEFAULT_CAPACITY);
-    // insert all the nodes into the array
-    collectAll(root, &na);
-    // sort the nodes alphabetically
-    qsort(na.nodes, na.size, sizeof(PokemonNode*), compareByNameNode);
-    // print every node (by alphabetical order)
-    for (int i = 0; i < na.size; ++i)
-        printPokemonNode(na.nodes[i]);
-    // free the array
-    free(na.nodes);
+    // set the bit of every species in the mask of its type
+    memset(typeMasks, 0, sizeof(typeMasks));
+    for (int id = 0; id < POKEDEX_LENGTH; ++id)
+        typeMasks[pokedex[id].TYPE][id / SPECIES_WORD_BITS] |= 1ULL << (id % SPECIES_WORD_BITS);
+}
+
+bool addTypeMask(const char* name, unsigned long long* mask)
+{
+    // find the type by its name (in any case)
+    for (int type = 0; type < TYPE_COUNT; ++type)
+    {
+        const char* typeName = getTypeName(type);
+        int i = 0;
+        while (name[i] != '\0' && toupper((unsigned char)name[i]) == typeName[i])
+            i++;
+        if (name[i] != '\0' || typeName[i] != '\0')
+            continue;
+        // add the species of the type to the mask
+        for (int word = 0; word < SPECIES_WORDS; ++word)
+            mask[word] |= typeMasks[type][word];
+        return true;
+    }
+    // the name is not a type
+    return false;
 }
 
-bool compareByNameNode(const void* a, const void* b)
+void displayPokemonByTypesMenu(const OwnerNode* owner)
 {
-    // compare nodes by their name
-    const PokemonNode* nodeA = *(const PokemonNode**)a;
-    const PokemonNode* nodeB = *(const PokemonNode**)b;
-    return strcmp(nodeA->data->name, nodeB->data->name);
+    // read the type names, and build the mask of all their species
+    printOutput("Enter types (e.g. FIRE WATER): ");
+    char* args[BATCH_MAX_ARGS];
+    const int count = splitCommand(getInputView(), args, BATCH_MAX_ARGS);
+    unsigned long long mask[SPECIES_WORDS] = {0};
+    for (int i = 0; i < count; ++i)
+    {
+        // if a name is not a type, inform the user and return
+        if (!addTypeMask(args[i], mask))
+        {
+            printOutput("Invalid type: %s\n", args[i]);
+            return;
+        }
+    }
+    displayPokemonByTypes(owner, mask);
+}
+
+void displayPokemonByTypes(const OwnerNode* owner, const unsigned long long* mask)
+{
+    // the owner's bitmap, masked by the types, holds exactly the matches, already in ID order
+    bool found = false;
+    for (int word = 0; word < SPECIES_WORDS; ++word)
+        for (unsigned long long bits = owner->species[word] & mask[word]; bits != 0; bits &= bits - 1)
+        {
+            const int id = word * SPECIES_WORD_BITS + lowestBit(bits);
+            writeOutput(pokemonLines[id].text, pokemonLines[id].length);
+            found = true;
+        }
+    // if nothing matched, inform the user
+    if (!found)
+        printOutput("No Pokemon of those types.\n");
+}
+
+void displayAlphabetical(const OwnerNode* owner)
+{
+    // go over the species by the order of their names, and print every one the owner has
+    for (int i = 0; i < POKEDEX_LENGTH; ++i)
+    {
+        const int id = alphabeticalIDs[i];
+        if (hasSpecies(owner, id))
+            writeOutput(pokemonLines[id].text, pokemonLines[id].length);
+    }
 }
 
 void initNodeArray(NodeArray* na, const int cap)
@@ -295,7 +671,7 @@ void initNodeArray(NodeArray* na, const int cap)
     // if the allocation failed, exit the program
     if (na->nodes == NULL)
     {
-        printf("Memory allocation failed. (initNodeArray: na->nodes)\n");
+        printOutput("Memory allocation failed. (initNodeArray: na->nodes)\n");
         exit(1);
     }
     // init the array struct variables
@@ -303,16 +679,15 @@ void initNodeArray(NodeArray* na, const int cap)
     na->capacity = cap;
 }
 
-void collectAll(PokemonNode* root, NodeArray* na)
+void collectInOrder(PokemonNode* root, NodeArray* na)
 {
     // if the given data has no nodes in it, return.
     if (root == NULL)
         return;
-    // add the root node
+    // add the left nodes, then the root node, then the right nodes
+    collectInOrder(root->left, na);
     addNode(na, root);
-    // repeat recursively for left and right
-    collectAll(root->left, na);
-    collectAll(root->right, na);
+    collectInOrder(root->right, na);
 }
 
 void addNode(NodeArray* na, PokemonNode* node)
@@ -327,7 +702,7 @@ void addNode(NodeArray* na, PokemonNode* node)
         // if the allocation has failed, exit teh program
         if (na->nodes == NULL)
         {
-            printf("Memory reallocation failed. (addNode: na->nodes)\n");
+            printOutput("Memory reallocation failed. (addNode: na->nodes)\n");
             exit(1);
         }
     }
@@ -354,6 +729,123 @@ void inOrderGeneric(const PokemonNode* root, const PokemonNodeConsumer consumer)
     inOrderGeneric(root->right, consumer);
 }
 
+void rangeGeneric(const PokemonNode* root, const int low, const int high, const PokemonNodeConsumer consumer)
+{
+    // if the root is NULL, return
+    if (root == NULL)
+        return;
+    const int id = root->data->id;
+    // only go left if smaller IDs can still be in the range, and only go right if bigger ones can
+    if (id > low)
+        rangeGeneric(root->left, low, high, consumer);
+    if (id >= low && id <= high)
+        consumer(root);
+    if (id < high)
+        rangeGeneric(root->right, low, high, consumer);
+}
+
+const PokemonNode* selectPokemon(const PokemonNode* root, int k)
+{
+    // walk down, using the subtree sizes to skip whole subtrees
+    while (root != NULL)
+    {
+        const int left = getPokemonSize(root->left);
+        if (k <= left)
+            root = root->left;
+        else if (k == left + 1)
+            return root;
+        else
+        {
+            k -= left + 1;
+            root = root->right;
+        }
+    }
+    // k is out of range
+    return NULL;
+}
+
+int rankPokemon(const PokemonNode* root, const int id)
+{
+    // walk down to the ID, counting everything that is to its left
+    int rank = 0;
+    while (root != NULL)
+    {
+        if (id <= root->data->id)
+            root = root->left;
+        else
+        {
+            rank += getPokemonSize(root->left) + 1;
+            root = root->right;
+        }
+    }
+    return rank;
+}
+
+void queryPokemon(const OwnerNode* owner)
+{
+    // if there is no Pokemon in the Pokedex, inform the user and return
+    if (owner->pokedexRoot == NULL)
+    {
+        printOutput("Pokedex is empty.\n");
+        return;
+    }
+    // print the menu
+    printOutput("Query:\n");
+    printOutput("1. IDs in a range\n");
+    printOutput("2. K-th lowest ID\n");
+    printOutput("3. Rank of an ID\n");
+    // read the chosen query and its arguments, and answer it
+    const int choice = readIntSafe("Your choice: ");
+    if (choice == 1)
+    {
+        const int low = readIntSafe("Enter lowest ID: ");
+        displayPokemonRange(owner, low, readIntSafe("Enter highest ID: "));
+    }
+    else if (choice == 2)
+        displayKthPokemon(owner, readIntSafe("Enter k: "));
+    else if (choice == 3)
+        displayPokemonRank(owner, readIntSafe("Enter Pokemon ID: "));
+    else
+        printOutput("Invalid choice.\n");
+}
+
+void displayPokemonRange(const OwnerNode* owner, const int low, const int high)
+{
+    // only IDs of the Pokedex can be in the tree
+    const int from = low < 1 ? 1 : low;
+    const int to = high > POKEDEX_LENGTH ? POKEDEX_LENGTH : high;
+    // the number of Pokemon in the range is the difference of two ranks
+    const int count = from > to ? 0 : rankPokemon(owner->pokedexRoot, to) - rankPokemon(owner->pokedexRoot, from - 1);
+    if (count == 0)
+    {
+        printOutput("No Pokemon in that range.\n");
+        return;
+    }
+    // print them by ID, visiting only the paths to the ends of the range and what is between them
+    printOutput("%d Pokemon with IDs %d to %d:\n", count, low, high);
+    rangeGeneric(owner->pokedexRoot, from - 1, to - 1, printPokemonNode);
+}
+
+void displayKthPokemon(const OwnerNode* owner, const int k)
+{
+    // select the node, and print it
+    const PokemonNode* node = selectPokemon(owner->pokedexRoot, k);
+    if (node == NULL)
+        printOutput("No such Pokemon (the Pokedex has %d).\n", getPokemonSize(owner->pokedexRoot));
+    else
+        printPokemonNode(node);
+}
+
+void displayPokemonRank(const OwnerNode* owner, const int id)
+{
+    // the rank is the number of lower IDs (the bit test says if the ID itself is there)
+    const int lower = rankPokemon(owner->pokedexRoot, id - 1);
+    if (hasSpecies(owner, id - 1))
+        printOutput("%s (ID %d) is number %d by ID.\n", pokedex[id - 1].name, id, lower + 1);
+    else
+        printOutput("No Pokemon ID %d found. %d Pokemon have lower IDs.\n", id, lower);
+}
+
 void displayPostOrder(const PokemonNode* root)
 {
     // print the nodes in the BT with the post-order algorithm
@@ -403,31 +895,72 @@ void BFSGeneric(const PokemonNode* root, const PokemonNodeConsumer consumer)
     // if the root is NULL, return
     if (root == NULL)
         return;
-    // for every level in the BT
-    for (int i = 0; true; ++i)
-        // activate the consumer on every node in it
-        if (!BTLevel(root, i, consumer))
-            // and if there is no nodes in the level, exit
-            break;
+    // a Pokedex never holds more nodes than there are species, so this is usually the last allocation
+    reservePokemonQueue(&levelQueue, POKEDEX_LENGTH);
+    // start from the root
+    pushPokemonQueue(&levelQueue, root);
+    // every node is popped once, and its children are queued behind the rest of its level
+    unsigned long long visited = 0;
+    for (; levelQueue.size > 0; ++visited)
+    {
+        const PokemonNode* node = popPokemonQueue(&levelQueue);
+        consumer(node);
+        if (node->left != NULL)
+            pushPokemonQueue(&levelQueue, node->left);
+        if (node->right != NULL)
+            pushPokemonQueue(&levelQueue, node->right);
+    }
+    addCounter(COUNTER_LEVEL_NODES, visited);
 }
 
-bool BTLevel(const PokemonNode* root, const int level, const PokemonNodeConsumer consumer)
+void reservePokemonQueue(PokemonQueue* queue, const int cap)
 {
-    // if the root is NULL, return
-    if (root == NULL)
-        return false;
-    // if the level is 0, just print the root
-    if (level == 0)
+    // if the queue is already big enough, there is nothing to do
+    if (queue->capacity >= cap)
+        return;
+    // allocate the new storage
+    const PokemonNode** nodes = malloc(cap * sizeof(PokemonNode*));
+    // if the allocation has failed, exit the program
+    if (nodes == NULL)
     {
-        consumer(root);
-        // return that we found a node in this level
-        return true;
+        printOutput("Memory allocation failed. (reservePokemonQueue: nodes)\n");
+        exit(1);
     }
-    // search for the node in the left and right nodes, and apply the consumer on the nodes in the level
-    const bool left = BTLevel(root->left, level - 1, consumer);
-    const bool right = BTLevel(root->right, level - 1, consumer);
-    // return if we found a node in the level
-    return left || right;
+    // copy the queued nodes in order, unwrapping the ring
+    for (int i = 0; i < queue->size; ++i)
+        nodes[i] = queue->nodes[(queue->head + i) % queue->capacity];
+    // replace the old storage
+    free(queue->nodes);
+    queue->nodes = nodes;
+    queue->head = 0;
+    queue->capacity = cap;
+}
+
+void pushPokemonQueue(PokemonQueue* queue, const PokemonNode* node)
+{
+    // if the ring is full, double it
+    if (queue->size == queue->capacity)
+        reservePokemonQueue(queue, queue->capacity > 0 ? queue->capacity * 2 : DEFAULT_CAPACITY);
+    // add the node behind the last one, wrapping around the end
+    queue->nodes[(queue->head + queue->size) % queue->capacity] = node;
+    queue->size++;
+}
+
+const PokemonNode* popPokemonQueue(PokemonQueue* queue)
+{
+    // take the first node and advance the head, wrapping around the end
+    const PokemonNode* node = queue->nodes[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->size--;
+    return node;
+}
+
+void freePokemonQueue(PokemonQueue* queue)
+{
+    // free the storage and reset the queue
+    free(queue->nodes);
+    queue->nodes = NULL;
+    queue->head = queue->size = queue->capacity = 0;
 }
 
 void pokedexMenu()
@@ -435,38 +968,37 @@ void pokedexMenu()
     // if there is no Pokedex, inform the user and return
     if (ownersHead == NULL)
     {
-        printf("No existing Pokedexes.\n");
+        printOutput("No existing Pokedexes.\n");
         return;
     }
     // print the menu
-    printf("\nExisting Pokedexes:\n");
-    const OwnerNode* owner = ownersHead;
+    printOutput("\nExisting Pokedexes:\n");
     // print every Pokedex name in the menu
-    for (int i = 0; i < ownerCount; i++, owner = owner->next)
-        printf("%d. %s\n", i + 1, owner->ownerName);
+    printOwnerList();
 
     // read the choice of the user of the Pokedex he wants to open
     int choice = readIntSafe("Choose a Pokedex by number: ");
     // make target the chosen Pokedex
-    OwnerNode* target = ownersHead;
-    for (int i = 1; i < choice; i++, target = target->next)
-    {
-    }
+    OwnerNode* target = getOwnerByNumber(choice);
 
     // inform the user
-    printf("\nEntering %s's Pokedex...\n", target->ownerName);
+    printOutput("\nEntering %s's Pokedex...\n", target->ownerName);
 
     // until the user exits
     while (true)
     {
         // print the menu
-        printf("\n-- %s's Pokedex Menu --\n", target->ownerName);
-        printf("1. Add Pokemon\n");
-        printf("2. Display Pokedex\n");
-        printf("3. Release Pokemon (by ID)\n");
-        printf("4. Pokemon Fight!\n");
-        printf("5. Evolve Pokemon\n");
-        printf("6. Back to Main\n");
+        printOutput("\n-- %s's Pokedex Menu --\n", target->ownerName);
+        printOutput("1. Add Pokemon\n");
+        printOutput("2. Display Pokedex\n");
+        printOutput("3. Release Pokemon (by ID)\n");
+        printOutput("4. Pokemon Fight!\n");
+        printOutput("5. Evolve Pokemon\n");
+        printOutput("6. Back to Main\n");
+        printOutput("7. Round Robin\n");
+        printOutput("8. Evolve All\n");
+        printOutput("9. Stats\n");
+        printOutput("10. Query by ID\n");
 
         // input the choice of the user
         choice = readIntSafe("Your choice: ");
@@ -491,11 +1023,23 @@ void pokedexMenu()
             break;
         case 6:
             // if the user chose to exit, exit.
-            printf("Back to Main Menu.\n");
+            printOutput("Back to Main Menu.\n");
             return;
+        case 7:
+            roundRobin(target);
+            break;
+        case 8:
+            evolveAllPokemon(target);
+            break;
+        case 9:
+            printPokedexStats(target);
+            break;
+        case 10:
+            queryPokemon(target);
+            break;
         default:
             // if the user entered an invalid option, inform him
-            printf("Invalid choice.\n");
+            printOutput("Invalid choice.\n");
         }
     }
 }
@@ -505,33 +1049,116 @@ void evolvePokemon(OwnerNode* owner)
     // if the Pokedex is empty, inform the user and return
     if (owner->pokedexRoot == NULL)
     {
-        printf("Cannot evolve. Pokedex empty.\n");
+        printOutput("Cannot evolve. Pokedex empty.\n");
         return;
     }
-    // read the ID of the Pokemon the user wants to evolve
-    const int choice = readIntSafe("Enter ID of Pokemon to evolve: ");
-    // search for the Pokemon in the Pokedex with the BFS algorithm
-    const PokemonNode* pokemon = searchPokemonBFS(owner->pokedexRoot, choice - 1);
-    // if the Pokemon does not exist, inform the user and return
-    if (pokemon == NULL)
+    // read the ID of the Pokemon the user wants to evolve, and evolve it
+    evolvePokemonByID(owner, readIntSafe("Enter ID of Pokemon to evolve: "));
+}
+
+void evolvePokemonByID(OwnerNode* owner, const int choice)
+{
+    // if the Pokedex is empty, inform the user and return
+    if (owner->pokedexRoot == NULL)
+    {
+        printOutput("Cannot evolve. Pokedex empty.\n");
+        return;
+    }
+    // if the Pokemon does not exist (a single bit test), inform the user and return
+    if (!hasSpecies(owner, choice - 1))
     {
-        printf("No Pokemon ID %d found.\n", choice);
+        printOutput("No Pokemon ID %d found.\n", choice);
         return;
     }
+    const PokemonData* pokemon = &pokedex[choice - 1];
     // if the Pokemon cannot evolve, inform the user and return
-    if (pokemon->data->CAN_EVOLVE == CANNOT_EVOLVE)
+    if (pokemon->CAN_EVOLVE == CANNOT_EVOLVE)
     {
-        printf("%s (ID %d) cannot evolve.\n", pokemon->data->name, pokemon->data->id + 1);
+        printOutput("%s (ID %d) cannot evolve.\n", pokemon->name, pokemon->id + 1);
         return;
     }
-    // remove the Pokemon from the Pokedex
-    removePokemonByID(owner->pokedexRoot, choice - 1);
-    // inform the user that the Pokemon has evolved
-    printf("Pokemon evolved from %s (ID %d) to %s (ID %d).",
-           pokedex[choice].name, choice, pokedex[choice + 1].name, choice + 1);
-    bool handleDupe = true;
-    // insert the evolved Pokemon into the Pokedex
-    owner->pokedexRoot = insertPokemonNode(owner->pokedexRoot, createPokemonNode(&pokedex[choice + 1]), &handleDupe);
+    // the evolution happens, so journal it
+    journalOwnerChange(JOURNAL_EVOLVE, owner->ownerName, choice);
+    // inform the user like an evolution always did (a removal, then an insertion), even when the node is reused
+    // (the evolved ID is always the next one)
+    printOutput("Removing Pokemon %s (ID %d).\n", pokemon->name, choice);
+    printOutput("Pokemon evolved from %s (ID %d) to %s (ID %d).\n",
+           pokemon->name, choice, pokedex[choice].name, choice + 1);
+    beginPokedexChange(owner);
+    clearSpecies(owner, choice - 1);
+    // if the evolved Pokemon is already in the Pokedex, the old one is just removed
+    if (hasSpecies(owner, choice))
+    {
+        owner->pokedexRoot = removeNodeBST(owner->pokedexRoot, choice - 1);
+        printOutput("Pokemon with ID %d is already in the Pokedex. No changes made.\n", choice + 1);
+        return;
+    }
+    // else, no ID lies between the old ID and the next one, so the node keeps its place in
+    // the BST and just takes the evolved data (no removal, no allocation and no rebalancing)
+    repointPokemonNode(owner->pokedexRoot, choice - 1, &pokedex[choice]);
+    setSpecies(owner, choice);
+}
+
+void evolveAllPokemon(OwnerNode* owner)
+{
+    // if the Pokedex is empty, inform the user and return
+    if (owner->pokedexRoot == NULL)
+    {
+        printOutput("Cannot evolve. Pokedex empty.\n");
+        return;
+    }
+    // if no Pokemon can evolve, nothing changes (so a lock-free writer does not even copy the BST)
+    bool canEvolve = false;
+    for (int id = 0; id < POKEDEX_LENGTH && !canEvolve; ++id)
+        canEvolve = hasSpecies(owner, id) && pokedex[id].CAN_EVOLVE == CAN_EVOLVE;
+    if (!canEvolve)
+    {
+        printOutput("No Pokemon can evolve.\n");
+        return;
+    }
+    beginPokedexChange(owner);
+    // flatten the BST by ID
+    NodeArray na;
+    initNodeArray(&na, POKEDEX_LENGTH);
+    collectInOrder(owner->pokedexRoot, &na);
+    // every Pokemon evolves at once: the evolved IDs come in the same order, so a duplicate
+    // (a Pokemon evolving into one that stays) is always right after the node it duplicates
+    int kept = 0, evolved = 0, merged = 0;
+    unsigned long long species[SPECIES_WORDS] = {0};
+    for (int i = 0; i < na.size; ++i)
+    {
+        PokemonNode* node = na.nodes[i];
+        const PokemonData* data = node->data;
+        if (data->CAN_EVOLVE == CAN_EVOLVE)
+        {
+            printOutput("Pokemon evolved from %s (ID %d) to %s (ID %d).\n",
+                        data->name, data->id + 1, pokedex[data->id + 1].name, data->id + 2);
+            data = &pokedex[data->id + 1];
+            evolved++;
+        }
+        // a duplicate is freed, anything else takes its (possibly evolved) data
+        if (kept > 0 && na.nodes[kept - 1]->data == data)
+        {
+            freePokemonNode(node);
+            merged++;
+            continue;
+        }
+        node->data = data;
+        na.nodes[kept++] = node;
+        species[data->id / SPECIES_WORD_BITS] |= 1ULL << (data->id % SPECIES_WORD_BITS);
+    }
+    // the new bitmap replaces the old one (and the species index follows)
+    replaceSpecies(owner, species);
+    // without duplicates, the order and the shape are unchanged, so the BST stays as it is
+    // (only its aggregates are refreshed)
+    if (merged > 0)
+        owner->pokedexRoot = buildBalancedTree(na.nodes, kept);
+    else
+        refreshPokemonTree(owner->pokedexRoot);
+    free(na.nodes);
+    // inform the user
+    journalOwnerChange(JOURNAL_EVOLVE_ALL, owner->ownerName, 0);
+    printOutput("%d Pokemon evolved, %d duplicates merged.\n", evolved, merged);
 }
 
 void pokemonFight(const OwnerNode* owner)
@@ -539,125 +1166,463 @@ void pokemonFight(const OwnerNode* owner)
     // if the Pokedex is empty, inform the user and return
     if (owner->pokedexRoot == NULL)
     {
-        printf("Pokedex is empty.\n");
+        printOutput("Pokedex is empty.\n");
         return;
     }
-    // read the IDs of the two Pokemon the user wants to fight
+    // read the IDs of the two Pokemon the user wants to fight, and let them fight
     const int first = readIntSafe("Enter ID of the first Pokemon: ");
     const int second = readIntSafe("Enter ID of the second Pokemon: ");
-    // search for the two Pokemon in the Pokedex with the BFS algorithm
-    const PokemonNode* firstNode = searchPokemonBFS(owner->pokedexRoot, first - 1);
-    const PokemonNode* secondNode = searchPokemonBFS(owner->pokedexRoot, second - 1);
-    // if one or both of the Pokemon do not exist, inform the user and return
-    if (secondNode == NULL || firstNode == NULL)
-    {
-        printf("One or both Pokemon IDs not found.\n");
-        return;
-    }
-    // print the details of the two Pokemon
-    printf("Pokemon 1: %s (Score = %.2f)\n",
-           firstNode->data->name, firstNode->data->attack * 1.5 + firstNode->data->hp * 1.2);
-    printf("Pokemon 2: %s (Score = %.2f)\n",
-           secondNode->data->name, secondNode->data->attack * 1.5 + secondNode->data->hp * 1.2);
-    // print the winner of the fight
-    if (firstNode->data->attack * 1.5 + firstNode->data->hp * 1.2
-        > secondNode->data->attack * 1.5 + secondNode->data->hp * 1.2)
-        printf("%s wins!\n", firstNode->data->name);
-    else if (firstNode->data->attack * 1.5 + firstNode->data->hp * 1.2
-        < secondNode->data->attack * 1.5 + secondNode->data->hp * 1.2)
-        printf("%s wins!\n", secondNode->data->name);
-    else printf("it's a tie!\n");
+    fightPokemonByID(owner, first, second);
 }
 
-PokemonNode* searchPokemonBFS(PokemonNode* root, const int id)
+void fightPokemonByID(const OwnerNode* owner, const int first, const int second)
 {
-    // nah it is not really BFS, but it is a search function ;)
-    // if the root is NULL, return NULL
-    if (root == NULL)
-        return NULL;
-    // if the root is the Pokemon we are looking for, return it
-    if (root->data->id == id)
-        return root;
-    // search for the Pokemon in the left and right nodes
-    PokemonNode* left = searchPokemonBFS(root->left, id);
-    PokemonNode* right = searchPokemonBFS(root->right, id);
-    // return the Pokemon if it was found
-    return left != NULL ? left : right;
+    // a single fight is a batch of one
+    fightPokemonPairs(owner, &first, &second, 1);
 }
 
-void freePokemon(OwnerNode* owner)
+void computeFightScores(void)
+{
+    // attack * 1.5 + hp * 1.2 in tenths is exact in integers, and orders every pair like the doubles do
+    for (int i = 0; i < POKEDEX_LENGTH; ++i)
+        pokemonScores[i] = pokedex[i].attack * SCORE_ATTACK_TENTHS + pokedex[i].hp * SCORE_HP_TENTHS;
+}
+
+void fightPokemonPairs(const OwnerNode* owner, const int* first, const int* second, const int count)
 {
     // if the Pokedex is empty, inform the user and return
     if (owner->pokedexRoot == NULL)
     {
-        printf("No Pokemon to release.\n");
+        printOutput("Pokedex is empty.\n");
         return;
     }
-    // read the ID of the Pokemon the user wants to release
-    const int id = readIntSafe("Enter Pokemon ID to release: ");
-    // remove the Pokemon from the Pokedex
-    owner->pokedexRoot = removePokemonByID(owner->pokedexRoot, id - 1);
-}
+    // if there are no pairs (or more than a batch line can hold), there is nothing to fight
+    if (count <= 0 || count > FIGHT_MAX_PAIRS)
+        return;
+    // gather the scores of both sides of every pair into packed columns (a batch line holds at most this many pairs)
+    int firstScores[FIGHT_MAX_PAIRS], secondScores[FIGHT_MAX_PAIRS];
+    signed char outcomes[FIGHT_MAX_PAIRS];
+    // (a do-while, so the compiler sees that the columns are filled before they are compared)
+    int pair = 0;
+    do
+    {
+        // a missing Pokemon scores 0, its pair is reported as not found anyway
+        firstScores[pair] = hasSpecies(owner, first[pair] - 1) ? pokemonScores[first[pair] - 1] : 0;
+        secondScores[pair] = hasSpecies(owner, second[pair] - 1) ? pokemonScores[second[pair] - 1] : 0;
+    }
+    while (++pair < count);
+    // decide every fight at once
+    compareScores(firstScores, secondScores, outcomes, count);
+    // report the fights in order
+    for (int i = 0; i < count; ++i)
+    {
+        // if one or both of the Pokemon do not exist (a bit test each), inform the user
+        if (!hasSpecies(owner, first[i] - 1) || !hasSpecies(owner, second[i] - 1))
+        {
+            printOutput("One or both Pokemon IDs not found.\n");
+            continue;
+        }
+        const PokemonData* firstData = &pokedex[first[i] - 1];
+        const PokemonData* secondData = &pokedex[second[i] - 1];
+        // print the details of the two Pokemon (a score in tenths always ends with a 0 in hundredths)
+        printOutput("Pokemon 1: %s (Score = %d.%d0)\n", firstData->name, firstScores[i] / 10, firstScores[i] % 10);
+        printOutput("Pokemon 2: %s (Score = %d.%d0)\n", secondData->name, secondScores[i] / 10, secondScores[i] % 10);
+        // print the winner of the fight
+        if (outcomes[i] > 0)
+            printOutput("%s wins!\n", firstData->name);
+        else if (outcomes[i] < 0)
+            printOutput("%s wins!\n", secondData->name);
+        else printOutput("it's a tie!\n");
+    }
+}
+
+void compareScores(const int* first, const int* second, signed char* outcomes, const int count)
+{
+    int i = 0;
+#ifdef __SSE2__
+    // compare four pairs at a time: each mask lane is -1 where it holds, so (lt - gt) is +1, -1 or 0
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(first + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(second + i));
+        int lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, _mm_sub_epi32(_mm_cmplt_epi32(a, b), _mm_cmpgt_epi32(a, b)));
+        for (int j = 0; j < 4; ++j)
+            outcomes[i + j] = (signed char)lanes[j];
+    }
+#endif
+    // compare the rest one by one
+    for (; i < count; ++i)
+        outcomes[i] = (signed char)((first[i] > second[i]) - (first[i] < second[i]));
+}
+
+void countRoundRobin(const int* scores, const int count, int* wins, int* ties)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int j = 0;
+        int won = 0, tied = 0;
+#ifdef __SSE2__
+        // fight the Pokemon against four others at a time: subtracting a mask lane (-1) counts one
+        const __m128i mine = _mm_set1_epi32(scores[i]);
+        __m128i wonLanes = _mm_setzero_si128(), tiedLanes = _mm_setzero_si128();
+        for (; j + 4 <= count; j += 4)
+        {
+            const __m128i others = _mm_loadu_si128((const __m128i*)(scores + j));
+            wonLanes = _mm_sub_epi32(wonLanes, _mm_cmpgt_epi32(mine, others));
+            tiedLanes = _mm_sub_epi32(tiedLanes, _mm_cmpeq_epi32(mine, others));
+        }
+        // add up the lanes
+        int lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, wonLanes);
+        won = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_si128((__m128i*)lanes, tiedLanes);
+        tied = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+        // fight the rest one by one
+        for (; j < count; ++j)
+        {
+            won += scores[i] > scores[j];
+            tied += scores[i] == scores[j];
+        }
+        // a Pokemon does not fight itself
+        wins[i] = won;
+        ties[i] = tied - 1;
+    }
+}
+
+void roundRobin(const OwnerNode* owner)
+{
+    // if the Pokedex is empty, inform the user and return
+    if (owner->pokedexRoot == NULL)
+    {
+        printOutput("Pokedex is empty.\n");
+        return;
+    }
+    // pack the IDs and the scores of the owned species, by walking the bitmap
+    int ids[POKEDEX_LENGTH], scores[POKEDEX_LENGTH], wins[POKEDEX_LENGTH], ties[POKEDEX_LENGTH];
+    int count = 0;
+    for (int word = 0; word < SPECIES_WORDS; ++word)
+        for (unsigned long long bits = owner->species[word]; bits != 0; bits &= bits - 1)
+        {
+            ids[count] = word * SPECIES_WORD_BITS + lowestBit(bits);
+            scores[count] = pokemonScores[ids[count]];
+            count++;
+        }
+    // let every Pokemon fight every other one
+    countRoundRobin(scores, count, wins, ties);
+    // rank them by wins, then by ties, then by ID (an insertion sort, there are at most 151)
+    int order[POKEDEX_LENGTH];
+    for (int i = 0; i < count; ++i)
+    {
+        int j = i;
+        while (j > 0 && (wins[order[j - 1]] < wins[i] || (wins[order[j - 1]] == wins[i] && ties[order[j - 1]] < ties[i])))
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    // print the ranking
+    printOutput("Round robin of %s's Pokedex:\n", owner->ownerName);
+    for (int i = 0; i < count; ++i)
+    {
+        const int k = order[i];
+        printOutput("%d. %s (ID %d, Score = %d.%d0): %d wins, %d ties, %d losses\n", i + 1,
+                    pokedex[ids[k]].name, ids[k] + 1, scores[k] / 10, scores[k] % 10,
+                    wins[k], ties[k], count - 1 - wins[k] - ties[k]);
+    }
+}
+
+PokemonNode* searchPokemonBFS(PokemonNode* root, const int id)
+{
+    // nah it is not really BFS, but it is a search function ;)
+    // walk down a single path, going left or right by comparing IDs (counting the nodes on the way)
+    unsigned long long visited = 0;
+    for (; root != NULL && root->data->id != id; ++visited)
+        root = id < root->data->id ? root->left : root->right;
+    addCounter(COUNTER_SEARCH_NODES, visited + (root != NULL));
+    // return the Pokemon if it was found (or NULL if we fell off the tree)
+    return root;
+}
+
+void freePokemon(OwnerNode* owner)
+{
+    // if the Pokedex is empty, inform the user and return
+    if (owner->pokedexRoot == NULL)
+    {
+        printOutput("No Pokemon to release.\n");
+        return;
+    }
+    // read the ID of the Pokemon the user wants to release, and release it
+    releasePokemonByID(owner, readIntSafe("Enter Pokemon ID to release: "));
+}
+
+void releasePokemonByID(OwnerNode* owner, const int id)
+{
+    // if the Pokedex is empty, inform the user and return
+    if (owner->pokedexRoot == NULL)
+    {
+        printOutput("No Pokemon to release.\n");
+        return;
+    }
+    // if the Pokemon does not exist (a single bit test), inform the user and return
+    if (!hasSpecies(owner, id - 1))
+    {
+        printOutput("Pokemon with ID %d not found.\n", id);
+        return;
+    }
+    // remove the Pokemon from the Pokedex
+    beginPokedexChange(owner);
+    owner->pokedexRoot = removePokemonByID(owner->pokedexRoot, id - 1);
+    clearSpecies(owner, id - 1);
+    journalOwnerChange(JOURNAL_RELEASE, owner->ownerName, id);
+}
 
 PokemonNode* removePokemonByID(PokemonNode* root, const int id)
 {
-    // if the root is NULL, inform the user and return NULL
-    if (root == NULL)
+    // search for the Pokemon first
+    const PokemonNode* pokemon = searchPokemonBFS(root, id);
+    // if the Pokemon does not exist, inform the user and return the root as is
+    if (pokemon == NULL)
     {
-        printf("Pokemon with ID %d not found.\n", id + 1);
-        return NULL;
+        printOutput("Pokemon with ID %d not found.\n", id + 1);
+        return root;
     }
-    // if the Pokemon is in the left node tree, recursively remove it
+    // inform the user that the Pokemon has been removed
+    printOutput("Removing Pokemon %s (ID %d).\n", pokemon->data->name, pokemon->data->id + 1);
+    // remove the Pokemon from the tree
+    return removeNodeBST(root, id);
+}
+
+PokemonNode* removeNodeBST(PokemonNode* root, const int id)
+{
+    // if the root is NULL, the Pokemon is not in this subtree
+    if (root == NULL)
+        return NULL;
+    // if the Pokemon is in the right node tree, recursively remove it
     if (root->data->id < id)
-        root->right = removePokemonByID(root->right, id);
-        // if the Pokemon is in the right node tree, recursively remove it
+        root->right = removeNodeBST(root->right, id);
+    // if the Pokemon is in the left node tree, recursively remove it
     else if (root->data->id > id)
-        root->left = removePokemonByID(root->left, id);
+        root->left = removeNodeBST(root->left, id);
     // if the Pokemon is the root, remove it
     else
     {
-        // inform the user that the Pokemon has been removed
-        printf("Removing Pokemon %s (ID %d).\n", root->data->name, root->data->id + 1);
-        bool handleDupe = false;
-        // if the Pokemon has two children
+        PokemonNode* replacement;
+        // if the Pokemon has two children, replace it with its in-order successor
         if (root->left != NULL && root->right != NULL)
-            // add the right child to the left child
-            root->left = insertPokemonNode(root->left, root->right, &handleDupe);
-        else if (root->right != NULL)
-            // if the Pokemon has only a right child, return the right child
-            root->left = root->right;
+        {
+            PokemonNode* right = removeMinPokemonNode(root->right, &replacement);
+            replacement->left = root->left;
+            replacement->right = right;
+        }
+        // else, replace it with its only child (or with nothing)
+        else
+            replacement = root->left != NULL ? root->left : root->right;
         // free the Pokemon
-        PokemonNode* tmp = root->left;
         freePokemonNode(root);
-        // return the left child
-        return tmp;
+        // if the subtree became empty, there is nothing to balance
+        if (replacement == NULL)
+            return NULL;
+        root = replacement;
     }
-    // if the Pokemon was not found, return the root
-    return root;
+    // rebalance the subtree on the way up
+    return balancePokemonNode(root);
+}
+
+PokemonNode* removeMinPokemonNode(PokemonNode* root, PokemonNode** min)
+{
+    // if there is no left child, the root is the minimum
+    if (root->left == NULL)
+    {
+        *min = root;
+        // its right subtree takes its place
+        return root->right;
+    }
+    // else, the minimum is in the left subtree
+    root->left = removeMinPokemonNode(root->left, min);
+    // rebalance the subtree on the way up
+    return balancePokemonNode(root);
 }
 
 void freePokemonNode(PokemonNode* node)
 {
-    // there is not much to do here, just free the PokemonNode
-    free(node);
+    // there is not much to do here, just give the PokemonNode back to its pool
+    freePoolObject(&pokemonPool, node);
 }
 
 void addPokemon(OwnerNode* owner)
 {
-    // read the ID of the Pokemon the user wants to add
-    const int id = readIntSafe("Enter ID to add: ");
+    // read the ID of the Pokemon the user wants to add, and add it
+    addPokemonByID(owner, readIntSafe("Enter ID to add: "));
+}
+
+void addPokemonByID(OwnerNode* owner, const int id)
+{
     // if the ID is invalid, inform the user and return
     if (id > POKEDEX_LENGTH || id < 1)
     {
-        printf("Invalid ID.\n");
+        printOutput("Invalid ID.\n");
+        return;
+    }
+    // if the Pokemon is already in the Pokedex (a single bit test), inform the user and return
+    if (hasSpecies(owner, id - 1))
+    {
+        printOutput("Pokemon with ID %d is already in the Pokedex. No changes made.\n", id);
         return;
     }
     bool handleDupe = true;
     // insert the Pokemon into the Pokedex
+    beginPokedexChange(owner);
     owner->pokedexRoot = insertPokemonNode(owner->pokedexRoot, createPokemonNode(&pokedex[id - 1]),
                                            &handleDupe);
-    // inform the user that the Pokemon has been added if it was not a duplicate
-    if (handleDupe) printf("Pokemon %s (ID %d) added.", pokedex[id - 1].name, id);
+    setSpecies(owner, id - 1);
+    journalOwnerChange(JOURNAL_ADD, owner->ownerName, id);
+    // inform the user that the Pokemon has been added
+    printOutput("Pokemon %s (ID %d) added.\n", pokedex[id - 1].name, id);
+}
+
+int getPokemonHeight(const PokemonNode* node)
+{
+    // an empty subtree has height 0
+    return node == NULL ? 0 : node->height;
+}
+
+int getPokemonSize(const PokemonNode* node)
+{
+    // an empty subtree has no Pokemon
+    return node == NULL ? 0 : node->size;
+}
+
+void updatePokemonNode(PokemonNode* node)
+{
+    // the height is one more than the height of the taller child
+    const int left = getPokemonHeight(node->left);
+    const int right = getPokemonHeight(node->right);
+    node->height = (left > right ? left : right) + 1;
+    // the aggregates are the node's own data combined with the aggregates of its children
+    node->size = 1 + getPokemonSize(node->left) + getPokemonSize(node->right);
+    node->totalHP = node->data->hp;
+    node->bestAttacker = node->data;
+    memset(node->typeCounts, 0, sizeof(node->typeCounts));
+    node->typeCounts[node->data->TYPE]++;
+    const PokemonNode* children[2] = {node->left, node->right};
+    for (int i = 0; i < 2; ++i)
+    {
+        const PokemonNode* child = children[i];
+        if (child == NULL)
+            continue;
+        node->totalHP += child->totalHP;
+        node->bestAttacker = betterAttacker(node->bestAttacker, child->bestAttacker);
+        for (int type = 0; type < TYPE_COUNT; ++type)
+            node->typeCounts[type] += child->typeCounts[type];
+    }
+}
+
+const PokemonData* betterAttacker(const PokemonData* a, const PokemonData* b)
+{
+    // the higher attack wins, and on a tie the lower ID
+    if (a->attack != b->attack)
+        return a->attack > b->attack ? a : b;
+    return a->id < b->id ? a : b;
+}
+
+PokemonNode* repointPokemonNode(PokemonNode* root, const int id, const PokemonData* data)
+{
+    // walk down to the Pokemon, give it the new data, and refresh the aggregates on the way up
+    if (root->data->id < id)
+        repointPokemonNode(root->right, id, data);
+    else if (root->data->id > id)
+        repointPokemonNode(root->left, id, data);
+    else
+        root->data = data;
+    updatePokemonNode(root);
+    return root;
+}
+
+void refreshPokemonTree(PokemonNode* root)
+{
+    // refresh the children first, so the root combines up-to-date aggregates
+    if (root == NULL)
+        return;
+    refreshPokemonTree(root->left);
+    refreshPokemonTree(root->right);
+    updatePokemonNode(root);
+}
+
+void printPokedexStats(const OwnerNode* owner)
+{
+    // if the Pokedex is empty, inform the user and return
+    const PokemonNode* root = owner->pokedexRoot;
+    if (root == NULL)
+    {
+        printOutput("Pokedex is empty.\n");
+        return;
+    }
+    // everything is read from the aggregates of the root, without walking the tree
+    printOutput("Stats of %s's Pokedex:\n", owner->ownerName);
+    printOutput("Pokemon: %d\n", root->size);
+    printOutput("Total HP: %d (average %.2f)\n", root->totalHP, (double)root->totalHP / root->size);
+    printOutput("Best attacker: %s (ID %d, Attack: %d)\n",
+                root->bestAttacker->name, root->bestAttacker->id + 1, root->bestAttacker->attack);
+    printOutput("Types:");
+    for (int type = 0, first = true; type < TYPE_COUNT; ++type)
+    {
+        if (root->typeCounts[type] == 0)
+            continue;
+        printOutput("%s %s: %d", first ? "" : ",", getTypeName(type), root->typeCounts[type]);
+        first = false;
+    }
+    printOutput("\n");
+}
+
+PokemonNode* rotateLeft(PokemonNode* root)
+{
+    // the right child becomes the new root of the subtree
+    PokemonNode* pivot = root->right;
+    root->right = pivot->left;
+    pivot->left = root;
+    // update the old root first, since it is now below the pivot
+    updatePokemonNode(root);
+    updatePokemonNode(pivot);
+    return pivot;
+}
+
+PokemonNode* rotateRight(PokemonNode* root)
+{
+    // the left child becomes the new root of the subtree
+    PokemonNode* pivot = root->left;
+    root->left = pivot->right;
+    pivot->right = root;
+    // update the old root first, since it is now below the pivot
+    updatePokemonNode(root);
+    updatePokemonNode(pivot);
+    return pivot;
+}
+
+PokemonNode* balancePokemonNode(PokemonNode* root)
+{
+    // refresh the cached height of the root
+    updatePokemonNode(root);
+    // compute the balance factor of the root
+    const int balance = getPokemonHeight(root->left) - getPokemonHeight(root->right);
+    // if the left subtree is too tall, rotate right (left-right case first rotates the child)
+    if (balance > 1)
+    {
+        if (getPokemonHeight(root->left->left) < getPokemonHeight(root->left->right))
+            root->left = rotateLeft(root->left);
+        return rotateRight(root);
+    }
+    // if the right subtree is too tall, rotate left (right-left case first rotates the child)
+    if (balance < -1)
+    {
+        if (getPokemonHeight(root->right->right) < getPokemonHeight(root->right->left))
+            root->right = rotateRight(root->right);
+        return rotateLeft(root);
+    }
+    // the subtree is already balanced
+    return root;
 }
 
 PokemonNode* insertPokemonNode(PokemonNode* root, PokemonNode* node, bool* handleDupe)
@@ -665,6 +1630,7 @@ PokemonNode* insertPokemonNode(PokemonNode* root, PokemonNode* node, bool* handl
     // if the root is NULL, return the node
     if (root == NULL)
         return node;
+    addCounter(COUNTER_INSERT_NODES, 1);
     // if the node is smaller than the root, insert it to the left
     if (node->data->id < root->data->id)
         root->left = insertPokemonNode(root->left, node, handleDupe);
@@ -676,14 +1642,16 @@ PokemonNode* insertPokemonNode(PokemonNode* root, PokemonNode* node, bool* handl
     {
         // duplicate in pokedex
         if (*handleDupe)
-            printf("Pokemon with ID %d is already in the Pokedex. No changes made.\n", node->data->id + 1);
+            printOutput("Pokemon with ID %d is already in the Pokedex. No changes made.\n", node->data->id + 1);
         // change the handleDupe to the opposite value to inform that the node is a duplicate for the outside function
         *handleDupe = !*handleDupe;
         // if the node is a duplicate, free it
         freePokemonNode(node);
+        // nothing changed, so there is nothing to rebalance
+        return root;
     }
-    // return the root after the insertion
-    return root;
+    // rebalance the root after the insertion and return it
+    return balancePokemonNode(root);
 }
 
 void mainMenu()
@@ -692,14 +1660,21 @@ void mainMenu()
     while (true)
     {
         // print the menu
-        printf("\n=== Main Menu ===\n"
+        printOutput("\n=== Main Menu ===\n"
             "1. New Pokedex\n"
             "2. Existing Pokedex\n"
             "3. Delete a Pokedex\n"
             "4. Merge Pokedexes\n"
             "5. Sort Owners by Name\n"
             "6. Print Owners in a direction X times\n"
-            "7. Exit\n");
+            "7. Exit\n"
+            "8. Keep Owners Sorted (on/off)\n"
+            "9. Save Snapshot\n"
+            "10. Load Snapshot\n"
+            "11. Compact Journal\n"
+            "12. Find Owners of a Pokemon\n"
+            "13. Merge Many Pokedexes\n"
+            "14. Show Counters\n");
         // read the choice of the user
         const int choice = readIntSafe("Your choice: ");
 
@@ -726,13 +1701,329 @@ void mainMenu()
             break;
         case 7:
             // if the user chose to exit, exit.
-            printf("Goodbye!\n");
+            printOutput("Goodbye!\n");
             return;
+        case 8:
+            toggleKeepOwnersSorted();
+            break;
+        case 9:
+            // the name is used before anything else is read
+            printOutput("Snapshot file: ");
+            saveSnapshot(getInputView());
+            break;
+        case 10:
+            printOutput("Snapshot file: ");
+            loadSnapshotCommand(getInputView());
+            break;
+        case 11:
+            compactJournal();
+            break;
+        case 12:
+            printSpeciesOwners(readIntSafe("Enter Pokemon ID: "));
+            break;
+        case 13:
+            mergeManyPokedexMenu();
+            break;
+        case 14:
+            printCounters();
+            break;
         default:
             // if the user entered an invalid option, inform him
-            printf("Invalid.\n");
+            printOutput("Invalid.\n");
+        }
+    }
+}
+
+void runBatch(void)
+{
+    // until the input ends, run every line as a command, straight from the input buffer
+    char* line;
+    while ((line = readLine()) != NULL)
+    {
+        runBatchCommand(line);
+        // write the results in big chunks
+        if (output.size >= OUTPUT_CAPACITY)
+            flushOutput();
+    }
+}
+
+void runBatchCommand(char* line)
+{
+    // split the line into words (quoted words may contain spaces)
+    char* args[BATCH_MAX_ARGS];
+    const int count = splitCommand(line, args, BATCH_MAX_ARGS);
+    // skip empty lines and comments
+    if (count == 0 || args[0][0] == '#')
+        return;
+    const char* command = args[0];
+    OwnerNode* owner = NULL;
+    int first = 0, second = 0;
+    // lock the owners for the command (the clients of the server run their commands at the same time),
+    // except for the reads of one owner in lock-free mode, which only announce the epoch they read in
+    const CommandLock lock = getCommandLock(command);
+    const bool lockFree = lockFreeReads && lock == LOCK_SHARED && count >= 2 && takesOwner(command);
+    OwnerNode view;
+    if (lockFree)
+        enterEpoch();
+    else if (lock == LOCK_EXCLUSIVE)
+        pthread_rwlock_wrlock(&ownersLock);
+    else
+        pthread_rwlock_rdlock(&ownersLock);
+    // the commands that work on a single owner look it up first, and lock it
+    if (count >= 2 && takesOwner(command))
+    {
+        owner = findOwnerByName(args[1]);
+        // if the owner does not exist, inform the user and return
+        if (owner == NULL)
+        {
+            printOutput("Owner '%s' not found.\n", args[1]);
+            if (lockFree)
+                leaveEpoch();
+            else
+                pthread_rwlock_unlock(&ownersLock);
+            return;
+        }
+        // a lock-free read works on the published version, a change on a private copy (in lock-free mode,
+        // made on the first real change), and an exclusive command has every owner to itself already
+        if (lockFree)
+            owner = readPublishedOwner(owner, &view);
+        else if (lock == LOCK_OWNER)
+            pthread_rwlock_wrlock(&owner->lock);
+        else if (lock == LOCK_SHARED)
+            pthread_rwlock_rdlock(&owner->lock);
+    }
+    // run the command
+    if (strcmp(command, "new") == 0 && count == 3 && parseIntArg(args[2], &first))
+    {
+        // the same checks as the interactive menu, but an invalid starter does not exit
+        if (findOwnerByName(args[1]) != NULL)
+            printOutput("Owner '%s' already exists. Not creating a new Pokedex.\n", args[1]);
+        else if (getStarter(first) == NULL)
+            printOutput("Invalid choice.\n");
+        else
+        {
+            // the owner keeps its own copy of the name
+            createPokedex(copyString(args[1]), getStarter(first));
+        }
+    }
+    else if (strcmp(command, "add") == 0 && count >= 3)
+    {
+        // add every given ID, in order
+        for (int i = 2; i < count; ++i)
+        {
+            if (parseIntArg(args[i], &first))
+                addPokemonByID(owner, first);
+            else
+                printOutput("Invalid ID.\n");
+        }
+    }
+    else if (strcmp(command, "release") == 0 && count == 3 && parseIntArg(args[2], &first))
+        releasePokemonByID(owner, first);
+    else if (strcmp(command, "fight") == 0 && count >= 4 && count % 2 == 0)
+    {
+        // every two IDs are a pair, and all the pairs are fought at once
+        int firstIDs[FIGHT_MAX_PAIRS], secondIDs[FIGHT_MAX_PAIRS];
+        int pairs = 0;
+        for (int i = 2; i < count; i += 2)
+        {
+            if (parseIntArg(args[i], &firstIDs[pairs]) && parseIntArg(args[i + 1], &secondIDs[pairs]))
+                pairs++;
+            else
+                printOutput("Invalid ID.\n");
+        }
+        if (pairs > 0)
+            fightPokemonPairs(owner, firstIDs, secondIDs, pairs);
+    }
+    else if (strcmp(command, "round-robin") == 0 && count == 2)
+        roundRobin(owner);
+    else if (strcmp(command, "evolve-all") == 0 && count == 2)
+        evolveAllPokemon(owner);
+    else if (strcmp(command, "stats") == 0 && count == 2)
+        printPokedexStats(owner);
+    else if (strcmp(command, "range") == 0 && count == 4 && parseIntArg(args[2], &first)
+        && parseIntArg(args[3], &second))
+        displayPokemonRange(owner, first, second);
+    else if (strcmp(command, "select") == 0 && count == 3 && parseIntArg(args[2], &first))
+        displayKthPokemon(owner, first);
+    else if (strcmp(command, "rank") == 0 && count == 3 && parseIntArg(args[2], &first))
+        displayPokemonRank(owner, first);
+    else if (strcmp(command, "evolve") == 0 && count == 3 && parseIntArg(args[2], &first))
+        evolvePokemonByID(owner, first);
+    else if (strcmp(command, "display") == 0 && count >= 4 && strcmp(args[2], "type") == 0)
+    {
+        // every word after "type" is a type name
+        unsigned long long mask[SPECIES_WORDS] = {0};
+        bool valid = true;
+        for (int i = 3; i < count && valid; ++i)
+            valid = addTypeMask(args[i], mask);
+        if (!valid)
+            printOutput("Invalid type.\n");
+        else if (owner->pokedexRoot == NULL)
+            printOutput("Pokedex is empty.\n");
+        else
+            displayPokemonByTypes(owner, mask);
+    }
+    else if (strcmp(command, "display") == 0 && count == 3 && parseDisplayArg(args[2], &first))
+        displayPokemonByChoice(owner, first);
+    else if (strcmp(command, "delete") == 0 && count == 2)
+        deleteOwner(owner);
+    else if (strcmp(command, "merge") == 0 && count == 3)
+    {
+        OwnerNode* firstOwner = findOwnerByName(args[1]);
+        OwnerNode* secondOwner = findOwnerByName(args[2]);
+        // if one of the owners does not exist, inform the user, else merge them
+        if (firstOwner == NULL || secondOwner == NULL)
+            printOutput("Owner not found.\n");
+        else
+            mergeOwners(firstOwner, secondOwner);
+    }
+    else if (strcmp(command, "merge-many") == 0 && count >= 3)
+    {
+        // the first name is the owner to merge into, the rest are absorbed
+        OwnerNode* owners[BATCH_MAX_ARGS];
+        bool found = true;
+        for (int i = 1; i < count && found; ++i)
+        {
+            owners[i - 1] = findOwnerByName(args[i]);
+            // if the owner does not exist, inform the user
+            if (owners[i - 1] == NULL)
+            {
+                printOutput("Owner '%s' not found.\n", args[i]);
+                found = false;
+            }
+        }
+        if (found)
+            mergeManyOwners(owners[0], owners + 1, count - 2);
+    }
+    else if (strcmp(command, "sort") == 0 && count == 1)
+        sortOwners();
+    else if (strcmp(command, "keep-sorted") == 0 && count == 1)
+        toggleKeepOwnersSorted();
+    else if (strcmp(command, "save") == 0 && count == 2)
+        saveSnapshot(args[1]);
+    else if (strcmp(command, "load") == 0 && count == 2)
+        loadSnapshotCommand(args[1]);
+    else if (strcmp(command, "compact") == 0 && count == 1)
+        compactJournal();
+    else if (strcmp(command, "owners") == 0 && count == 2 && parseIntArg(args[1], &first))
+        printSpeciesOwners(first);
+    else if (strcmp(command, "counters") == 0 && count == 1)
+        printCounters();
+    else if (strcmp(command, "list") == 0 && count == 1)
+    {
+        if (ownersHead == NULL)
+            printOutput("No existing Pokedexes.\n");
+        else
+            printOwnerList();
+    }
+    else if (strcmp(command, "print") == 0 && count == 3 && parseIntArg(args[2], &first)
+        && strchr("FfBb", args[1][0]) != NULL && args[1][1] == '\0')
+        printOwnersInDirection(args[1][0] == 'F' || args[1][0] == 'f', first);
+    // if the command is unknown or has the wrong arguments, inform the user
+    else
+        printOutput("Invalid command: %s\n", command);
+    // a lock-free read only leaves its epoch
+    if (lockFree)
+    {
+        leaveEpoch();
+        return;
+    }
+    // publish the change of the owner, then unlock it (an exclusive command may have removed it) and the owners
+    if (owner != NULL && lock == LOCK_OWNER)
+        publishPokedex(owner);
+    if (owner != NULL && lock != LOCK_EXCLUSIVE)
+        pthread_rwlock_unlock(&owner->lock);
+    pthread_rwlock_unlock(&ownersLock);
+}
+
+bool takesOwner(const char* command)
+{
+    // the commands whose first argument is the name of an owner
+    static const char* const names[] = {
+        "add", "release", "fight", "evolve", "display", "delete", "round-robin", "evolve-all", "stats", "range",
+        "select", "rank"
+    };
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i)
+        if (strcmp(command, names[i]) == 0)
+            return true;
+    return false;
+}
+
+CommandLock getCommandLock(const char* command)
+{
+    // the commands that add, remove or reorder owners (or save all of them at once)
+    static const char* const exclusive[] = {
+        "new", "delete", "merge", "merge-many", "sort", "keep-sorted", "save", "load", "compact"
+    };
+    // the commands that change the Pokedex of their owner
+    static const char* const changing[] = {"add", "release", "evolve", "evolve-all"};
+    for (int i = 0; i < (int)(sizeof(exclusive) / sizeof(exclusive[0])); ++i)
+        if (strcmp(command, exclusive[i]) == 0)
+            return LOCK_EXCLUSIVE;
+    for (int i = 0; i < (int)(sizeof(changing) / sizeof(changing[0])); ++i)
+        if (strcmp(command, changing[i]) == 0)
+            return LOCK_OWNER;
+    // every other command only reads
+    return LOCK_SHARED;
+}
+
+int splitCommand(char* line, char** args, const int maxArgs)
+{
+    int count = 0;
+    while (count < maxArgs)
+    {
+        // skip the spaces before the next word
+        while (isspace((unsigned char)*line))
+            line++;
+        // if the line ended, there are no more words
+        if (*line == '\0')
+            break;
+        // a quoted word ends at the closing quote, any other word at the next space
+        if (*line == '"')
+        {
+            args[count++] = ++line;
+            while (*line != '\0' && *line != '"')
+                line++;
+        }
+        else
+        {
+            args[count++] = line;
+            while (*line != '\0' && !isspace((unsigned char)*line))
+                line++;
+        }
+        // terminate the word in place, and continue after it
+        if (*line != '\0')
+            *line++ = '\0';
+    }
+    return count;
+}
+
+bool parseIntArg(const char* arg, int* value)
+{
+    // parse the whole word as a base 10 integer
+    char* end;
+    const long parsed = strtol(arg, &end, 10);
+    // if there were no digits or there are leftover chars, the word is invalid
+    if (end == arg || *end != '\0')
+        return false;
+    *value = (int)parsed;
+    return true;
+}
+
+bool parseDisplayArg(const char* arg, int* choice)
+{
+    // the traversal names, in the order of the display menu
+    static const char* const names[] = {"bfs", "pre", "in", "post", "alpha"};
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i)
+    {
+        if (strcmp(arg, names[i]) == 0)
+        {
+            *choice = i + 1;
+            return true;
         }
     }
+    // else, it may be the number of one of those options
+    return parseIntArg(arg, choice) && *choice >= 1 && *choice <= (int)(sizeof(names) / sizeof(names[0]));
 }
 
 void printOwnersCircular()
@@ -740,13 +2031,16 @@ void printOwnersCircular()
     // if there are no owners, inform the user and return
     if (ownersHead == NULL)
     {
-        printf("No owners.\n");
+        printOutput("No owners.\n");
         return;
     }
     // scan the direction the user wants to print the owners
-    printf("Enter direction (F or B): ");
-    char direction;
-    scanf(" %c", &direction);
+    printOutput("Enter direction (F or B): ");
+    // the direction is the first char of the next non-empty line
+    const char* line = getInputView();
+    while (line[0] == '\0' && !(input.ended && input.position == input.size))
+        line = getInputView();
+    char direction = line[0];
     // if the direction is forwards, set the direction to true
     if (direction == 'F' || direction == 'f')
         direction = true;
@@ -756,16 +2050,28 @@ void printOwnersCircular()
     // if the direction is invalid, inform the user and return
     else
     {
-        printf("Invalid direction.\n");
+        printOutput("Invalid direction.\n");
+        return;
+    }
+    // read the number of times the user wants to print the owners, and print them
+    printOwnersInDirection(direction, readIntSafe("How many prints? "));
+}
+
+void printOwnersInDirection(const bool forward, const int times)
+{
+    // if there are no owners, inform the user and return
+    if (ownersHead == NULL)
+    {
+        printOutput("No owners.\n");
         return;
     }
-    scanf(" "); // consume newline
-    // read the number of times the user wants to print the owners
-    const int times = readIntSafe("How many prints? ");
-    const OwnerNode* curr = ownersHead;
-    // print the owners in the chosen direction
-    for (int i = 0; i < times; ++i, curr = direction ? curr->next : curr->prev)
-        printf("[%d] %s\n", i + 1, curr->ownerName);
+    // print the owners in the chosen direction, stepping around the table instead of the pointers
+    int position = 0;
+    for (int i = 0; i < times; ++i)
+    {
+        printOutput("[%d] %s\n", i + 1, ownerTable.owners[position]->ownerName);
+        position = forward ? (position + 1) % ownerCount : (position + ownerCount - 1) % ownerCount;
+    }
 }
 
 void sortOwners(void)
@@ -773,101 +2079,651 @@ void sortOwners(void)
     // if there are less than 2 owners to sort, inform the user and return
     if (ownerCount < 2)
     {
-        printf("0 or 1 owners only => no need to sort.\n");
+        printOutput("0 or 1 owners only => no need to sort.\n");
         return;
     }
-    // sort the owners by their name using Bubble Sort
-    for (int i = 1; i < ownerCount; ++i)
+    // if the owners are already sorted, there is nothing to do
+    if (!ownersSorted)
     {
-        OwnerNode* curr = ownersHead;
-        for (int j = 1; j < ownerCount; ++j)
+        // open the ring into a NULL-terminated list and merge sort it
+        ownersTail->next = NULL;
+        ownersHead = mergeSortOwners(ownersHead);
+        // walk the sorted list to fix the prev pointers and find the new tail
+        OwnerNode* prev = ownersHead;
+        while (prev->next != NULL)
         {
-            if (strcmp(curr->ownerName, curr->next->ownerName) > 0)
-                swapOwnerData(curr, curr->next);
-            curr = curr->next;
+            prev->next->prev = prev;
+            prev = prev->next;
         }
+        // close the ring again
+        ownersTail = prev;
+        ownersTail->next = ownersHead;
+        ownersHead->prev = ownersTail;
+        ownersSorted = true;
+        // every position changed, so refill the table
+        rebuildOwnerTable();
+        // the order of the owners is part of the state, so journal it
+        journalOwnerChange(JOURNAL_SORT, NULL, 0);
     }
     // inform the user that the owners have been sorted
-    printf("Owners sorted by name.\n");
+    printOutput("Owners sorted by name.\n");
 }
 
-void swapOwnerData(OwnerNode* a, OwnerNode* b)
+OwnerNode* mergeSortOwners(OwnerNode* head)
 {
-    // swap the data of the two owners using temporary variables
-    char* tmp = a->ownerName;
-    a->ownerName = b->ownerName;
-    b->ownerName = tmp;
-    PokemonNode* tmpRoot = a->pokedexRoot;
-    a->pokedexRoot = b->pokedexRoot;
-    b->pokedexRoot = tmpRoot;
+    // a list of 0 or 1 owners is already sorted
+    if (head == NULL || head->next == NULL)
+        return head;
+    // find the middle of the list (the slow pointer moves half as fast as the fast one)
+    OwnerNode* slow = head;
+    const OwnerNode* fast = head->next;
+    while (fast != NULL && fast->next != NULL)
+    {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    // split the list after the middle, sort both halves and merge them
+    OwnerNode* second = slow->next;
+    slow->next = NULL;
+    return mergeOwnerLists(mergeSortOwners(head), mergeSortOwners(second));
 }
 
-void mergePokedexMenu()
+OwnerNode* mergeOwnerLists(OwnerNode* a, OwnerNode* b)
 {
-    // if there are less than 2 owners to merge, inform the user and return
-    if (ownerCount < 2)
+    // a dummy head, so the first append is not a special case
+    OwnerNode dummy;
+    OwnerNode* tail = &dummy;
+    // always append the smaller first owner (ties keep the order of a, so the sort is stable)
+    unsigned long long compares = 0;
+    for (; a != NULL && b != NULL; ++compares)
     {
-        printf("Not enough owners to merge.\n");
-        return;
+        if (strcmp(a->ownerName, b->ownerName) <= 0)
+        {
+            tail->next = a;
+            a = a->next;
+        }
+        else
+        {
+            tail->next = b;
+            b = b->next;
+        }
+        tail = tail->next;
     }
-    // print the menu
-    printf("\n=== Merge Pokedexes ===\n");
-    // scan the names of the two owners the user wants to merge
-    printf("Enter name of first owner: ");
-    char* first = getDynamicInput();
-    printf("Enter name of second owner: ");
-    char* second = getDynamicInput();
-    // find the owners by their names
-    OwnerNode* firstOwner = findOwnerByName(first);
-    OwnerNode* secondOwner = findOwnerByName(second);
-    // inform the user that the owners are being merged
-    printf("Merging %s and %s...\n", first, second);
-    // if the Pokedex of the first owner is empty,
-    // set the Pokedex of the first owner to the Pokedex of the second owner
-    if (firstOwner->pokedexRoot == NULL)
-        firstOwner->pokedexRoot = secondOwner->pokedexRoot;
+    addCounter(COUNTER_SORT_COMPARES, compares);
+    // append whatever is left
+    tail->next = a != NULL ? a : b;
+    return dummy.next;
+}
+
+void toggleKeepOwnersSorted(void)
+{
+    // flip the option
+    keepOwnersSorted = !keepOwnersSorted;
+    journalOwnerChange(JOURNAL_KEEP_SORTED, NULL, 0);
+    if (keepOwnersSorted)
+    {
+        // sort the owners now, so new owners have a sorted list to be inserted into
+        if (!ownersSorted)
+            sortOwners();
+        printOutput("Owners will be kept sorted by name.\n");
+    }
+    else
+        printOutput("New owners will be added at the end.\n");
+}
+
+void mergePokedexMenu()
+{
+    // if there are less than 2 owners to merge, inform the user and return
+    if (ownerCount < 2)
+    {
+        printOutput("Not enough owners to merge.\n");
+        return;
+    }
+    // print the menu
+    printOutput("\n=== Merge Pokedexes ===\n");
+    // scan the names of the two owners the user wants to merge, and find the owners by their names
+    // (each name is looked up right away, since reading the next line may reuse its buffer)
+    printOutput("Enter name of first owner: ");
+    OwnerNode* firstOwner = findOwnerByName(getInputView());
+    printOutput("Enter name of second owner: ");
+    OwnerNode* secondOwner = findOwnerByName(getInputView());
+    // if one of the owners does not exist, inform the user, else merge them
+    if (firstOwner == NULL || secondOwner == NULL)
+        printOutput("Owner not found.\n");
+    else
+        mergeOwners(firstOwner, secondOwner);
+}
+
+void mergeOwners(OwnerNode* firstOwner, OwnerNode* secondOwner)
+{
+    // an owner cannot absorb itself (it would be removed, Pokedex and all), so inform the user and return
+    if (firstOwner == secondOwner)
+    {
+        printOutput("Invalid owners to merge.\n");
+        return;
+    }
+    // inform the user that the owners are being merged
+    printOutput("Merging %s and %s...\n", firstOwner->ownerName, secondOwner->ownerName);
+    // journal the merge while both names still exist
+    if (isJournaling())
+    {
+        beginJournalRecord(JOURNAL_MERGE);
+        writeJournalName(firstOwner->ownerName);
+        writeJournalName(secondOwner->ownerName);
+        endJournalRecord();
+    }
+    // in lock-free mode, both Pokedexes are merged as private copies (readers keep the published ones)
+    beginPokedexChange(firstOwner);
+    beginPokedexChange(secondOwner);
+    // work out which species the second owner would add, a word at a time
+    bool addsSpecies = false;
+    for (int i = 0; i < SPECIES_WORDS; ++i)
+        if (secondOwner->species[i] & ~firstOwner->species[i])
+            addsSpecies = true;
+    // if the Pokedex of the first owner is empty,
+    // set the Pokedex of the first owner to the Pokedex of the second owner
+    if (firstOwner->pokedexRoot == NULL)
+        firstOwner->pokedexRoot = secondOwner->pokedexRoot;
     // else, if the Pokedexes are not the same, merge the second Pokedex into the first Pokedex
     else if (firstOwner != secondOwner)
-        firstOwner->pokedexRoot = mergeRoots(firstOwner->pokedexRoot, secondOwner->pokedexRoot);
+    {
+        // if the second owner adds nothing, its nodes are all duplicates and are just freed
+        if (addsSpecies)
+            firstOwner->pokedexRoot = mergeRoots(firstOwner->pokedexRoot, secondOwner->pokedexRoot);
+        else
+            freePokemonTree(secondOwner->pokedexRoot);
+    }
+    // the first owner now owns the union of both bitmaps
+    unsigned long long species[SPECIES_WORDS];
+    for (int i = 0; i < SPECIES_WORDS; ++i)
+        species[i] = firstOwner->species[i] | secondOwner->species[i];
+    replaceSpecies(firstOwner, species);
+    publishPokedex(firstOwner);
     // inform the user that the merge has been completed
-    printf("Merge completed.\n");
+    printOutput("Merge completed.\n");
     // remove the second owner's Pokedex
     secondOwner->pokedexRoot = NULL;
+    // inform the user that the second owner has been removed after merging (before its name is freed)
+    printOutput("Owner '%s' has been removed after merging.\n", secondOwner->ownerName);
     // free the second owner's Pokedex
     freeOwnerNode(secondOwner);
-    // inform the user that the second owner has been removed after merging
-    printf("Owner '%s' has been removed after merging.\n", second);
-    // free the names of the owners
-    free(first);
-    free(second);
 }
 
 PokemonNode* mergeRoots(PokemonNode* first, PokemonNode* second)
 {
-    // if the second node Pokemon is NULL, return the first Pokemon (the BST)
+    // if one of the Pokedexes is empty, the other one is the result
     if (second == NULL)
         return first;
-    // merge the left and right nodes of the second Pokemon into the first Pokemon
-    first = mergeRoots(first, second->left);
-    first = mergeRoots(first, second->right);
-    // remove the left, right nodes of the second Pokemon from its data
-    second->left = second->right = NULL;
-    bool handleDupe = false;
-    // insert the second Pokemon into the first Pokemon BST
-    return insertPokemonNode(first, second, &handleDupe);
+    if (first == NULL)
+        return second;
+    // flatten both BSTs into arrays sorted by ID
+    NodeArray a, b, merged;
+    initNodeArray(&a, POKEDEX_LENGTH);
+    initNodeArray(&b, POKEDEX_LENGTH);
+    initNodeArray(&merged, POKEDEX_LENGTH);
+    collectInOrder(first, &a);
+    collectInOrder(second, &b);
+    // merge the two sorted arrays, keeping the first owner's node on duplicates
+    int i = 0, j = 0;
+    while (i < a.size && j < b.size)
+    {
+        if (a.nodes[i]->data->id < b.nodes[j]->data->id)
+            addNode(&merged, a.nodes[i++]);
+        else if (a.nodes[i]->data->id > b.nodes[j]->data->id)
+            addNode(&merged, b.nodes[j++]);
+        else
+        {
+            // a duplicate, free the second owner's node
+            addNode(&merged, a.nodes[i++]);
+            freePokemonNode(b.nodes[j++]);
+        }
+    }
+    // add the rest of whichever array is left
+    while (i < a.size)
+        addNode(&merged, a.nodes[i++]);
+    while (j < b.size)
+        addNode(&merged, b.nodes[j++]);
+    // relink the very same nodes into a balanced BST
+    PokemonNode* root = buildBalancedTree(merged.nodes, merged.size);
+    // free the arrays
+    free(a.nodes);
+    free(b.nodes);
+    free(merged.nodes);
+    return root;
 }
 
-OwnerNode* findOwnerByName(const char* name)
+PokemonNode* buildBalancedTree(PokemonNode** nodes, const int count)
+{
+    // an empty range gives an empty tree
+    if (count <= 0)
+        return NULL;
+    // the middle node becomes the root, and each half becomes one of its subtrees
+    const int mid = count / 2;
+    PokemonNode* root = nodes[mid];
+    root->left = buildBalancedTree(nodes, mid);
+    root->right = buildBalancedTree(nodes + mid + 1, count - mid - 1);
+    // refresh the cached height of the root
+    updatePokemonNode(root);
+    return root;
+}
+
+void mergeManyPokedexMenu(void)
+{
+    // if there are less than 2 owners to merge, inform the user and return
+    if (ownerCount < 2)
+    {
+        printOutput("Not enough owners to merge.\n");
+        return;
+    }
+    // print the menu
+    printOutput("\n=== Merge Many Pokedexes ===\n");
+    // find the owner to merge into, and then every owner to absorb, by their names
+    // (each name is looked up right away, since reading the next line may reuse its buffer)
+    printOutput("Enter name of the owner to merge into: ");
+    OwnerNode* target = findOwnerByName(getInputView());
+    OwnerNode** sources = malloc(ownerCount * sizeof(OwnerNode*));
+    // if the allocation has failed, exit the program
+    if (sources == NULL)
+    {
+        printOutput("Memory allocation failed. (mergeManyPokedexMenu: sources)\n");
+        exit(1);
+    }
+    int count = 0;
+    bool found = target != NULL;
+    printOutput("Enter names of the owners to absorb (an empty line to finish):\n");
+    while (true)
+    {
+        const char* name = getInputView();
+        if (name[0] == '\0')
+            break;
+        OwnerNode* source = findOwnerByName(name);
+        // remember that an owner was not found, but keep reading until the empty line
+        if (source == NULL)
+            found = false;
+        else if (count < ownerCount)
+            sources[count++] = source;
+    }
+    // if one of the owners does not exist, inform the user, else merge them
+    if (!found)
+        printOutput("Owner not found.\n");
+    else
+        mergeManyOwners(target, sources, count);
+    free(sources);
+}
+
+void mergeManyOwners(OwnerNode* target, OwnerNode** sources, const int count)
+{
+    // every source must be a different owner than the target and than the other sources
+    // (the positions are borrowed as marks, and restored right away)
+    bool valid = count > 0;
+    target->position = -target->position - 1;
+    for (int i = 0; i < count && valid; ++i)
+    {
+        if (sources[i]->position < 0)
+            valid = false;
+        else
+            sources[i]->position = -sources[i]->position - 1;
+    }
+    for (int i = 0; i < count; ++i)
+        if (sources[i]->position < 0)
+            sources[i]->position = -sources[i]->position - 1;
+    if (target->position < 0)
+        target->position = -target->position - 1;
+    // if not, inform the user and return
+    if (!valid)
+    {
+        printOutput("Invalid owners to merge.\n");
+        return;
+    }
+    printOutput("Merging %d owners into %s...\n", count, target->ownerName);
+    // journal the merge while all the names still exist
+    if (isJournaling())
+    {
+        beginJournalRecord(JOURNAL_MERGE_MANY);
+        writeJournalName(target->ownerName);
+        writeJournalInt(count);
+        for (int i = 0; i < count; ++i)
+            writeJournalName(sources[i]->ownerName);
+        endJournalRecord();
+    }
+    // the owners in merge order: the target first, so its nodes win on duplicates, then the sources
+    OwnerNode** owners = malloc((count + 1) * sizeof(OwnerNode*));
+    // if the allocation has failed, exit the program
+    if (owners == NULL)
+    {
+        printOutput("Memory allocation failed. (mergeManyOwners: owners)\n");
+        exit(1);
+    }
+    owners[0] = target;
+    memcpy(owners + 1, sources, count * sizeof(OwnerNode*));
+    // in lock-free mode, the Pokedexes are merged as private copies (readers keep the published ones)
+    for (int i = 0; i <= count; ++i)
+        beginPokedexChange(owners[i]);
+    // split the owners into contiguous chunks, one per worker, and flatten the chunks in parallel
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int workerCount = (count + 1 + MERGE_OWNERS_PER_WORKER - 1) / MERGE_OWNERS_PER_WORKER;
+    if (cores < 1)
+        cores = 1;
+    if (workerCount > cores)
+        workerCount = cores;
+    if (workerCount > MERGE_MAX_WORKERS)
+        workerCount = MERGE_MAX_WORKERS;
+    MergeWorker* workers = calloc(workerCount, sizeof(MergeWorker));
+    // if the allocation has failed, exit the program
+    if (workers == NULL)
+    {
+        printOutput("Memory allocation failed. (mergeManyOwners: workers)\n");
+        exit(1);
+    }
+    for (int w = 0, start = 0; w < workerCount; ++w)
+    {
+        const int end = (int)((long)(count + 1) * (w + 1) / workerCount);
+        workers[w].owners = owners + start;
+        workers[w].count = end - start;
+        start = end;
+        // the first chunk is flattened by this thread, and so is any chunk whose thread cannot start
+        workers[w].started = w > 0 && pthread_create(&workers[w].thread, NULL, flattenOwnersWorker, &workers[w]) == 0;
+    }
+    flattenOwnersWorker(&workers[0]);
+    for (int w = 1; w < workerCount; ++w)
+    {
+        if (workers[w].started)
+            pthread_join(workers[w].thread, NULL);
+        else
+            flattenOwnersWorker(&workers[w]);
+    }
+    // reduce the chunks in order: the first chunk that has a species gives its node, the rest are duplicates
+    PokemonNode* nodes[POKEDEX_LENGTH];
+    int size = 0;
+    unsigned long long species[SPECIES_WORDS] = {0};
+    for (int id = 0; id < POKEDEX_LENGTH; ++id)
+    {
+        PokemonNode* kept = NULL;
+        for (int w = 0; w < workerCount; ++w)
+        {
+            PokemonNode* node = workers[w].kept[id];
+            if (node == NULL)
+                continue;
+            if (kept == NULL)
+                kept = node;
+            else
+                freePokemonNode(node);
+        }
+        if (kept == NULL)
+            continue;
+        nodes[size++] = kept;
+        species[id / SPECIES_WORD_BITS] |= 1ULL << (id % SPECIES_WORD_BITS);
+    }
+    // hand the duplicates the workers chained up to the node pool, a whole chain at a time
+    for (int w = 0; w < workerCount; ++w)
+        freePoolChain(&pokemonPool, &workers[w].duplicates);
+    // the target gets one balanced BST of the union, and the union of the bitmaps
+    target->pokedexRoot = buildBalancedTree(nodes, size);
+    replaceSpecies(target, species);
+    publishPokedex(target);
+    printOutput("Merge completed.\n");
+    // the sources' trees now belong to the target
+    for (int i = 0; i < count; ++i)
+    {
+        sources[i]->pokedexRoot = NULL;
+        printOutput("Owner '%s' has been removed after merging.\n", sources[i]->ownerName);
+    }
+    removeOwners(sources, count);
+    // free the buffers
+    free(workers);
+    free(owners);
+}
+
+void* flattenOwnersWorker(void* arg)
+{
+    // flatten every tree of the chunk, in order, so the earlier owners keep their nodes
+    MergeWorker* worker = arg;
+    for (int i = 0; i < worker->count; ++i)
+        flattenPokemonTree(worker->owners[i]->pokedexRoot, worker);
+    return NULL;
+}
+
+void flattenPokemonTree(PokemonNode* root, MergeWorker* worker)
+{
+    // if the root is NULL, return
+    if (root == NULL)
+        return;
+    // the children first: a duplicate is chained through its first word, so it must not be read afterwards
+    flattenPokemonTree(root->left, worker);
+    flattenPokemonTree(root->right, worker);
+    const int id = root->data->id;
+    // the first node of a species is kept, the others are chained up to be freed
+    if (worker->kept[id] == NULL)
+        worker->kept[id] = root;
+    else
+        chainPoolObject(&worker->duplicates, root);
+}
+
+void removeOwners(OwnerNode** owners, const int count)
+{
+    // mark the owners, and take them out of the indexes
+    for (int i = 0; i < count; ++i)
+    {
+        unindexOwner(owners[i]);
+        const unsigned long long none[SPECIES_WORDS] = {0};
+        replaceSpecies(owners[i], none);
+        if (owners[i]->published == NULL || owners[i]->pokedexRoot != owners[i]->published->root)
+            freePokemonTree(owners[i]->pokedexRoot);
+        owners[i]->position = -1;
+    }
+    // compact the table in one pass, keeping the order of the rest
+    int kept = 0;
+    for (int i = 0; i < ownerCount; ++i)
+    {
+        OwnerNode* owner = ownerTable.owners[i];
+        if (owner->position < 0)
+            continue;
+        owner->position = kept;
+        ownerTable.owners[kept++] = owner;
+    }
+    ownerCount = kept;
+    // relink the circle from the table
+    for (int i = 0; i < ownerCount; ++i)
+    {
+        ownerTable.owners[i]->next = ownerTable.owners[(i + 1) % ownerCount];
+        ownerTable.owners[i]->prev = ownerTable.owners[(i + ownerCount - 1) % ownerCount];
+    }
+    ownersHead = ownerCount > 0 ? ownerTable.owners[0] : NULL;
+    ownersTail = ownerCount > 0 ? ownerTable.owners[ownerCount - 1] : NULL;
+    // free the owners, with their names and their locks, once no reader can see them
+    for (int i = 0; i < count; ++i)
+        retireOwner(owners[i]);
+}
+
+OwnerNode* getOwnerByNumber(const int number)
+{
+    // numbers below 1 give the head, and numbers past the end wrap around the circle
+    return ownerTable.owners[number <= 1 ? 0 : (number - 1) % ownerCount];
+}
+
+void printOwnerList(void)
+{
+    // print every owner with its 1-based number
+    for (int i = 0; i < ownerCount; i++)
+        printOutput("%d. %s\n", i + 1, ownerTable.owners[i]->ownerName);
+}
+
+void insertOwnerInTable(OwnerNode* owner, const int position)
+{
+    // if the table is full, double its capacity
+    if (ownerCount == ownerTable.capacity)
+    {
+        ownerTable.capacity = ownerTable.capacity > 0 ? ownerTable.capacity * 2 : DEFAULT_CAPACITY;
+        ownerTable.owners = realloc(ownerTable.owners, ownerTable.capacity * sizeof(OwnerNode*));
+        // if the allocation has failed, exit the program
+        if (ownerTable.owners == NULL)
+        {
+            printOutput("Memory reallocation failed. (insertOwnerInTable: ownerTable.owners)\n");
+            exit(1);
+        }
+    }
+    // shift the owners after the position one slot to the right
+    memmove(ownerTable.owners + position + 1, ownerTable.owners + position,
+            (ownerCount - position) * sizeof(OwnerNode*));
+    ownerTable.owners[position] = owner;
+    // update the positions of the owner and of every owner that moved (ownerCount is not updated yet)
+    for (int i = position; i <= ownerCount; ++i)
+        ownerTable.owners[i]->position = i;
+}
+
+void removeOwnerFromTable(const OwnerNode* owner)
+{
+    // shift the owners after the owner one slot to the left (ownerCount is not updated yet)
+    memmove(ownerTable.owners + owner->position, ownerTable.owners + owner->position + 1,
+            (ownerCount - owner->position - 1) * sizeof(OwnerNode*));
+    // update the positions of every owner that moved
+    for (int i = owner->position; i < ownerCount - 1; ++i)
+        ownerTable.owners[i]->position = i;
+}
+
+void rebuildOwnerTable(void)
 {
-    // for every owner, if the name is the same as the given name, return the owner
+    // walk the linked list from the head, storing every owner at its position
     OwnerNode* curr = ownersHead;
     for (int i = 0; i < ownerCount; ++i, curr = curr->next)
     {
-        if (strcmp(name, curr->ownerName) == 0)
-            return curr;
+        ownerTable.owners[i] = curr;
+        curr->position = i;
     }
-    // if the owner was not found, return NULL
-    return NULL;
+}
+
+int findSortedOwnerPosition(const char* name)
+{
+    // binary search for the first owner whose name does not come before the given name
+    int low = 0, high = ownerCount;
+    unsigned long long compares = 0;
+    for (; low < high; ++compares)
+    {
+        const int mid = low + (high - low) / 2;
+        if (strcmp(ownerTable.owners[mid]->ownerName, name) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    addCounter(COUNTER_LOOKUP_COMPARES, compares);
+    return low;
+}
+
+OwnerNode* findOwnerByName(const char* name)
+{
+    // the table is loaded once, since lock-free readers look names up while it is replaced
+    const OwnerIndexTable* table = LOAD_ACQUIRE(&ownerIndex.table);
+    // if there are no owners, there is nothing to find
+    if (table == NULL)
+        return NULL;
+    // probe like findOwnerIndexEntry, but read every slot once (a writer may fill it in the meantime)
+    const unsigned int hash = hashOwnerName(name);
+    for (unsigned int i = hash & table->mask; true; i = (i + 1) & table->mask)
+    {
+        OwnerNode* owner = LOAD_ACQUIRE(&table->entries[i].owner);
+        if (owner == NULL)
+            return NULL;
+        if (owner == &ownerTombstone || LOAD_RELAXED(&table->entries[i].hash) != hash)
+            continue;
+        // only a matching hash costs a string comparison
+        addCounter(COUNTER_LOOKUP_COMPARES, 1);
+        if (strcmp(name, owner->ownerName) == 0)
+            return owner;
+    }
+}
+
+unsigned int hashOwnerName(const char* name)
+{
+    // FNV-1a: xor in each byte, then multiply by the prime
+    unsigned int hash = FNV_OFFSET_BASIS;
+    for (; *name != '\0'; ++name)
+        hash = (hash ^ (unsigned char)*name) * FNV_PRIME;
+    return hash;
+}
+
+OwnerIndexEntry* findOwnerIndexEntry(const char* name, const unsigned int hash)
+{
+    // the capacity is a power of two, so the mask replaces the modulo
+    const unsigned int mask = ownerIndex.table->mask;
+    // probe linearly from the home slot, skipping tombstones, until the name or an empty slot
+    for (unsigned int i = hash & mask; true; i = (i + 1) & mask)
+    {
+        OwnerIndexEntry* entry = &ownerIndex.table->entries[i];
+        if (entry->owner == NULL)
+            return entry;
+        if (entry->owner == &ownerTombstone || entry->hash != hash)
+            continue;
+        // only a matching hash costs a string comparison
+        addCounter(COUNTER_LOOKUP_COMPARES, 1);
+        if (strcmp(name, entry->owner->ownerName) == 0)
+            return entry;
+    }
+}
+
+void indexOwner(OwnerNode* owner)
+{
+    // keep at most half of the slots in use (live + tombstones), so probes stay short
+    if ((ownerIndex.used + 1) * 2 > ownerIndex.capacity)
+    {
+        // double the capacity only if the live owners need it, else just drop the tombstones
+        int capacity = ownerIndex.capacity > 0 ? ownerIndex.capacity : DEFAULT_CAPACITY;
+        while ((ownerCount + 1) * 2 > capacity / 2)
+            capacity *= 2;
+        resizeOwnerIndex(capacity);
+    }
+    // readers find the owner only through the index, so its Pokedex is published first
+    publishPokedex(owner);
+    // the name is not indexed, so the probe ends at an empty slot (filled hash first, for lock-free readers)
+    const unsigned int hash = hashOwnerName(owner->ownerName);
+    OwnerIndexEntry* entry = findOwnerIndexEntry(owner->ownerName, hash);
+    STORE_RELAXED(&entry->hash, hash);
+    STORE_RELEASE(&entry->owner, owner);
+    ownerIndex.used++;
+}
+
+void unindexOwner(OwnerNode* owner)
+{
+    // leave a tombstone, so the probe sequences of other names stay intact
+    STORE_RELEASE(&findOwnerIndexEntry(owner->ownerName, hashOwnerName(owner->ownerName))->owner, &ownerTombstone);
+}
+
+void resizeOwnerIndex(const int capacity)
+{
+    // keep the old slots aside
+    OwnerIndexTable* old = ownerIndex.table;
+    const int oldCapacity = ownerIndex.capacity;
+    // allocate the new, empty slots
+    OwnerIndexTable* table = calloc(1, sizeof(OwnerIndexTable) + capacity * sizeof(OwnerIndexEntry));
+    // if the allocation has failed, exit the program
+    if (table == NULL)
+    {
+        printOutput("Memory allocation failed. (resizeOwnerIndex: table)\n");
+        exit(1);
+    }
+    table->mask = capacity - 1;
+    ownerIndex.used = 0;
+    // move every live owner into the new slots (tombstones are dropped)
+    for (int i = 0; i < oldCapacity; ++i)
+    {
+        if (old->entries[i].owner == NULL || old->entries[i].owner == &ownerTombstone)
+            continue;
+        table->entries[findEmptyIndexSlot(table, old->entries[i].hash)] = old->entries[i];
+        ownerIndex.used++;
+    }
+    // publish the new slots, and free the old ones (once no reader is in them)
+    ownerIndex.capacity = capacity;
+    STORE_RELEASE(&ownerIndex.table, table);
+    if (old != NULL)
+        retireObject(RETIRED_INDEX, old);
+}
+
+unsigned int findEmptyIndexSlot(const OwnerIndexTable* table, const unsigned int hash)
+{
+    // probe linearly from the home slot until an empty one
+    unsigned int i = hash & table->mask;
+    while (table->entries[i].owner != NULL)
+        i = (i + 1) & table->mask;
+    return i;
 }
 
 void deletePokedex()
@@ -875,174 +2731,2090 @@ void deletePokedex()
     // if there are no owners, inform the user and return
     if (ownersHead == NULL)
     {
-        printf("No existing Pokedexes to delete.\n");
+        printOutput("No existing Pokedexes to delete.\n");
         return;
     }
     // print the menu
-    printf("\n=== Delete a Pokedex ===\n");
+    printOutput("\n=== Delete a Pokedex ===\n");
     // print the names of the owners
-    const OwnerNode* owner = ownersHead;
-    for (int i = 0; i < ownerCount; i++, owner = owner->next)
-        printf("%d. %s\n", i + 1, owner->ownerName);
+    printOwnerList();
     // read the choice of the user
     const int choice = readIntSafe("Choose a Pokedex to delete by number: ");
-    // make target the chosen Pokedex
-    OwnerNode* target = ownersHead;
-    for (int i = 1; i < choice; i++, target = target->next)
-    {
-    }
+    // delete the chosen Pokedex
+    deleteOwner(getOwnerByNumber(choice));
+}
+
+void deleteOwner(OwnerNode* target)
+{
     // inform the user that the Pokedex is being deleted
-    printf("Deleting %s's entire Pokedex...\n", target->ownerName);
+    printOutput("Deleting %s's entire Pokedex...\n", target->ownerName);
+    journalOwnerChange(JOURNAL_DELETE, target->ownerName, 0);
     // free the Pokedex
     freeOwnerNode(target);
     // inform the user that the Pokedex has been deleted
-    printf("Pokedex deleted.\n");
+    printOutput("Pokedex deleted.\n");
 }
 
 void freeOwnerNode(OwnerNode* owner)
 {
-    // free the BST of the owner
-    freePokemonTree(owner->pokedexRoot);
+    // remove the owner from the name index, and from the owners of every species it has
+    unindexOwner(owner);
+    const unsigned long long none[SPECIES_WORDS] = {0};
+    replaceSpecies(owner, none);
+    // free the BST of the owner (unless lock-free readers may still be in it, then it is retired with the owner)
+    if (owner->published == NULL || owner->pokedexRoot != owner->published->root)
+        freePokemonTree(owner->pokedexRoot);
+    // remove the owner from the Linked List of the owners
+    removeOwnerFromCircularList(owner);
+    // free the owner, with its name and its lock, once no reader can see it
+    retireOwner(owner);
+    // decrease the number of owners
+    ownerCount--;
+}
+
+void removeOwnerFromCircularList(OwnerNode* target)
+{
+    // remove the owner from the owner table
+    removeOwnerFromTable(target);
     // redirect the pointers of the Linked List of the owners
-    owner->prev->next = owner->next;
-    owner->next->prev = owner->prev;
+    target->prev->next = target->next;
+    target->next->prev = target->prev;
     // if the owner is the head of the Linked List, set the head to the next owner
-    if (owner == ownersHead)
-        ownersHead = owner->next;
+    if (target == ownersHead)
+        ownersHead = target->next;
     // if the owner is the tail of the Linked List, set the tail to the previous owner
-    if (owner == ownersTail)
-        ownersTail = owner->prev;
+    if (target == ownersTail)
+        ownersTail = target->prev;
     // if the owner is the only owner in the Linked List, set the head and tail to NULL
-    if (owner == ownersHead && owner == ownersTail)
+    if (target == ownersHead && target == ownersTail)
         ownersHead = ownersTail = NULL;
-    // free the name of the owner
-    free(owner->ownerName);
-    // free the owner
-    free(owner);
-    // decrease the number of owners
-    ownerCount--;
+}
+
+void freePokdexes(OwnerNode** pPockdexes)
+{
+    // lock-free readers can not find any owner from now on, and the ones that already did are waited for
+    OwnerIndexTable* table = ownerIndex.table;
+    if (lockFreeReads)
+    {
+        STORE_RELEASE(&ownerIndex.table, NULL);
+        synchronizeEpochs();
+    }
+    // every name is allocated on its own, so free them one by one (with the locks)
+    for (int i = 0; i < ownerCount; ++i)
+    {
+        free(ownerTable.owners[i]->ownerName);
+        pthread_rwlock_destroy(&ownerTable.owners[i]->lock);
+    }
+    // every node lives in a slab, so release all the slabs at once without walking the trees
+    releasePool(&pokemonPool);
+    releasePool(&ownerPool);
+    releasePool(&versionPool);
+    // free the owner table
+    free(ownerTable.owners);
+    ownerTable.owners = NULL;
+    ownerTable.capacity = 0;
+    // free the name index and the species index
+    free(table);
+    STORE_RELEASE(&ownerIndex.table, NULL);
+    ownerIndex.capacity = ownerIndex.used = 0;
+    freeSpeciesOwners();
+    // the list is now empty
+    *pPockdexes = NULL;
+    ownersTail = NULL;
+    ownerCount = 0;
 }
 
 void freePokemonTree(PokemonNode* root)
 {
-    // if the root is NULL, return
-    if (root == NULL)
-        return;
-    // recursively free the left and right nodes and their children
-    freePokemonTree(root->left);
-    freePokemonTree(root->right);
-    // free the root
-    freePokemonNode(root);
+    // the chain of freed nodes
+    PoolChain chain = {NULL, NULL, 0};
+    // walk the tree without recursion: rotate left children up until there are none
+    while (root != NULL)
+    {
+        if (root->left != NULL)
+        {
+            PokemonNode* pivot = root->left;
+            root->left = pivot->right;
+            pivot->right = root;
+            root = pivot;
+        }
+        else
+        {
+            // the root has no left child, so it can be chained onto the free list
+            PokemonNode* next = root->right;
+            chainPoolObject(&chain, root);
+            root = next;
+        }
+    }
+    // hand the whole chain to the pool in one step
+    freePoolChain(&pokemonPool, &chain);
 }
 
-void newPokedex()
+void* allocPoolObject(ObjectPool* pool)
 {
-    // scan the name of the owner of the new Pokedex
-    printf("Your name: ");
-    char* ownerName = getDynamicInput();
-    // if the name was not scanned properly, inform the user and exit
-    if (ownerName == NULL)
+    addCounter(COUNTER_ALLOCATIONS, 1);
+    pthread_mutex_lock(&pool->lock);
+    // if there is a recycled object, reuse it
+    if (pool->freeList != NULL)
     {
-        printf("Failed to read name.\n");
-        exit(1);
+        void* object = pool->freeList;
+        pool->freeList = *(void**)object;
+        pthread_mutex_unlock(&pool->lock);
+        return object;
     }
-    // if an owner with the same name already exist, inform the user and return
-    const OwnerNode* curr = ownersHead;
-    for (int i = 0; i < ownerCount; ++i, curr = curr->next)
+    // if the newest slab is used up, allocate a new one
+    if (pool->cursor == pool->end)
     {
-        if (strcmp(ownerName, curr->ownerName) == 0)
+        char* slab = malloc(SLAB_OBJECTS * pool->objectSize);
+        // if the allocation has failed, exit the program
+        if (slab == NULL)
         {
-            printf("Owner '%s' already exists. Not creating a new Pokedex.\n", ownerName);
-            // free the name of the owner
-            free(ownerName);
-            return;
+            printOutput("Memory allocation failed. (allocPoolObject: slab)\n");
+            exit(1);
         }
+        // the first object slot links the slab to the previous one
+        *(void**)slab = pool->slabs;
+        pool->slabs = slab;
+        pool->cursor = slab + pool->objectSize;
+        pool->end = slab + SLAB_OBJECTS * pool->objectSize;
+    }
+    // carve the next object from the slab
+    void* object = pool->cursor;
+    pool->cursor += pool->objectSize;
+    pthread_mutex_unlock(&pool->lock);
+    return object;
+}
+
+void freePoolObject(ObjectPool* pool, void* object)
+{
+    // push the object onto the free list
+    addCounter(COUNTER_FREES, 1);
+    pthread_mutex_lock(&pool->lock);
+    *(void**)object = pool->freeList;
+    pool->freeList = object;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void chainPoolObject(PoolChain* chain, void* object)
+{
+    // push the object onto the chain, linked through its first word like the free list (the first one is the tail)
+    if (chain->head == NULL)
+        chain->tail = object;
+    *(void**)object = chain->head;
+    chain->head = object;
+    chain->count++;
+}
+
+void freePoolChain(ObjectPool* pool, PoolChain* chain)
+{
+    // if the chain is empty, there is nothing to hand over
+    if (chain->head == NULL)
+        return;
+    addCounter(COUNTER_FREES, chain->count);
+    // put the whole chain in front of the free list in one step
+    pthread_mutex_lock(&pool->lock);
+    *(void**)chain->tail = pool->freeList;
+    pool->freeList = chain->head;
+    pthread_mutex_unlock(&pool->lock);
+    // the chain is empty again
+    chain->head = chain->tail = NULL;
+    chain->count = 0;
+}
+
+void releasePool(ObjectPool* pool)
+{
+    // free the slabs one after the other
+    while (pool->slabs != NULL)
+    {
+        void* previous = *(void**)pool->slabs;
+        free(pool->slabs);
+        pool->slabs = previous;
+    }
+    // the pool is empty again
+    pool->freeList = NULL;
+    pool->cursor = pool->end = NULL;
+}
+
+void newPokedex()
+{
+    // scan the name of the owner of the new Pokedex (still inside the input buffer)
+    printOutput("Your name: ");
+    const char* name = getInputView();
+    // if an owner with the same name already exist, inform the user and return
+    if (findOwnerByName(name) != NULL)
+    {
+        printOutput("Owner '%s' already exists. Not creating a new Pokedex.\n", name);
+        return;
     }
+    // the name is kept, so copy it before the next line is read
+    char* ownerName = copyString(name);
     // scan the starter Pokemon of the new Pokedex
-    printf("Choose Starter:\n"
+    printOutput("Choose Starter:\n"
         "1. Bulbasaur\n"
         "2. Charmander\n"
         "3. Squirtle\n");
     // read the choice of the user
-    const int choice = readIntSafe("Your choice: ");
-    PokemonNode* starter;
+    const PokemonData* starter = getStarter(readIntSafe("Your choice: "));
+    // we assume input validation
+    if (starter == NULL)
+    {
+        printOutput("Invalid choice. (newPokedex: choice)\n");
+        exit(1);
+    }
+    // create the Pokedex
+    createPokedex(ownerName, starter);
+}
+
+const PokemonData* getStarter(const int choice)
+{
     // get the starter Pokemon according to the choice of the user
     switch (choice)
     {
     case 1:
-        starter = createPokemonNode(&pokedex[BULBASAUR]);
-        break;
+        return &pokedex[BULBASAUR];
     case 2:
-        starter = createPokemonNode(&pokedex[CHARMANDER]);
-        break;
+        return &pokedex[CHARMANDER];
     case 3:
-        starter = createPokemonNode(&pokedex[SQUIRTLE]);
-        break;
-    default: // we assume input validation
-        printf("Invalid choice. (newPokedex: choice)\n");
-        exit(1);
+        return &pokedex[SQUIRTLE];
+    default:
+        return NULL;
     }
+}
+
+void createPokedex(char* ownerName, const PokemonData* starter)
+{
     // add the owner to the Linked List of the owners
-    addOwner(createOwner(ownerName, starter));
+    addOwner(createOwner(ownerName, createPokemonNode(starter)));
+    journalOwnerChange(JOURNAL_NEW, ownerName, starter->id);
     // inform the user that the Pokedex has been created
-    printf("New Pokedex created for %s with starter %s.\n", ownerName, starter->data->name);
+    printOutput("New Pokedex created for %s with starter %s.\n", ownerName, starter->name);
 }
 
 void addOwner(OwnerNode* owner)
 {
-    // if the Linked List of the owners is empty, update it accordingly
-    if (ownersHead == NULL)
+    // link the owner into the Linked List of the owners
+    linkOwnerInCircularList(owner);
+    // add the owner to the name index
+    indexOwner(owner);
+    // update the number of owners
+    ownerCount++;
+}
+
+void linkOwnerInCircularList(OwnerNode* newOwner)
+{
+    // if the Linked List of the owners is empty, update it accordingly
+    if (ownersHead == NULL)
     {
-        ownersHead = owner;
-        ownersTail = owner;
-        owner->next = owner;
-        owner->prev = owner;
+        ownersHead = newOwner;
+        ownersTail = newOwner;
+        newOwner->next = newOwner;
+        newOwner->prev = newOwner;
+        insertOwnerInTable(newOwner, 0);
+        return;
     }
-    // else, add the owner to the end of the Linked List
+    // the position of the new owner (by default after the tail, at the end)
+    int position = ownerCount;
+    // if the list is kept sorted, binary search the table for the first name that comes after the new one
+    if (keepOwnersSorted)
+        position = findSortedOwnerPosition(newOwner->ownerName);
+    // else, appending keeps the list sorted only if the new name comes last
     else
     {
-        ownersTail->next = owner;
-        owner->prev = ownersTail;
-        owner->next = ownersHead;
-        ownersHead->prev = owner;
-        ownersTail = owner;
+        addCounter(COUNTER_SORT_COMPARES, 1);
+        if (strcmp(ownersTail->ownerName, newOwner->ownerName) > 0)
+            ownersSorted = false;
     }
-    // update the number of owners
-    ownerCount++;
+    // the owner to insert before (inserting before the head of a circle is appending)
+    OwnerNode* before = position < ownerCount ? ownerTable.owners[position] : ownersHead;
+    insertOwnerInTable(newOwner, position);
+    // link the owner between before->prev and before
+    newOwner->next = before;
+    newOwner->prev = before->prev;
+    before->prev->next = newOwner;
+    before->prev = newOwner;
+    // update the head or the tail if the owner was inserted at one of the ends
+    if (position == 0)
+        ownersHead = newOwner;
+    else if (position == ownerCount)
+        ownersTail = newOwner;
 }
 
 OwnerNode* createOwner(char* name, PokemonNode* starter)
 {
-    // allocate memory for the new owner
-    OwnerNode* owner = malloc(sizeof(OwnerNode));
-    // if the allocation has failed, exit the program
-    if (owner == NULL)
-    {
-        printf("Memory allocation failed. (createOwner: owner)\n");
-        exit(1);
-    }
+    // take memory for the new owner from the owner pool
+    OwnerNode* owner = allocPoolObject(&ownerPool);
     // set the details of the owner
     owner->ownerName = name;
     owner->pokedexRoot = starter;
     owner->next = NULL;
     owner->prev = NULL;
+    pthread_rwlock_init(&owner->lock, NULL);
+    owner->published = NULL;
+    // the species bitmap starts with just the starter Pokemon
+    memset(owner->species, 0, sizeof(owner->species));
+    if (starter != NULL)
+        setSpecies(owner, starter->data->id);
     // return the newly created owner
     return owner;
 }
 
-PokemonNode* createPokemonNode(const PokemonData* data)
+bool hasSpecies(const OwnerNode* owner, const int id)
+{
+    // IDs outside the Pokedex are never owned
+    if (id < 0 || id >= POKEDEX_LENGTH)
+        return false;
+    // test the bit of the ID in its word
+    return (owner->species[id / SPECIES_WORD_BITS] >> (id % SPECIES_WORD_BITS)) & 1ULL;
+}
+
+int lowestBit(const unsigned long long bits)
+{
+#ifdef __GNUC__
+    // a single instruction where the compiler has one
+    return __builtin_ctzll(bits);
+#else
+    // else, count the trailing zeros one by one
+    int index = 0;
+    while (!((bits >> index) & 1ULL))
+        index++;
+    return index;
+#endif
+}
+
+void setSpecies(OwnerNode* owner, const int id)
+{
+    // if the bit is already set, nothing changes
+    if (hasSpecies(owner, id))
+        return;
+    // set the bit of the ID in its word, and add the owner to the owners of the species
+    owner->species[id / SPECIES_WORD_BITS] |= 1ULL << (id % SPECIES_WORD_BITS);
+    pthread_mutex_lock(&speciesLock);
+    addSpeciesOwner(id, owner);
+    pthread_mutex_unlock(&speciesLock);
+}
+
+void clearSpecies(OwnerNode* owner, const int id)
+{
+    // if the bit is already clear, nothing changes
+    if (!hasSpecies(owner, id))
+        return;
+    // clear the bit of the ID in its word, and remove the owner from the owners of the species
+    owner->species[id / SPECIES_WORD_BITS] &= ~(1ULL << (id % SPECIES_WORD_BITS));
+    pthread_mutex_lock(&speciesLock);
+    removeSpeciesOwner(id, owner);
+    pthread_mutex_unlock(&speciesLock);
+}
+
+void replaceSpecies(OwnerNode* owner, const unsigned long long* species)
+{
+    // only the bits that differ touch the species index
+    pthread_mutex_lock(&speciesLock);
+    for (int word = 0; word < SPECIES_WORDS; ++word)
+    {
+        for (unsigned long long bits = owner->species[word] ^ species[word]; bits != 0; bits &= bits - 1)
+        {
+            const int id = word * SPECIES_WORD_BITS + lowestBit(bits);
+            if ((species[word] >> (id % SPECIES_WORD_BITS)) & 1ULL)
+                addSpeciesOwner(id, owner);
+            else
+                removeSpeciesOwner(id, owner);
+        }
+        owner->species[word] = species[word];
+    }
+    pthread_mutex_unlock(&speciesLock);
+}
+
+unsigned int hashOwnerPointer(const OwnerNode* owner)
+{
+    // owners are at least 16-byte apart, so drop the low bits and spread the rest (Fibonacci hashing)
+    return (unsigned int)((uintptr_t)owner >> 4) * 2654435761u;
+}
+
+OwnerNode** findSpeciesOwnerSlot(const SpeciesOwners* set, const OwnerNode* owner)
+{
+    // the capacity is a power of two, so the mask replaces the modulo
+    const unsigned int mask = set->capacity - 1;
+    // probe linearly from the home slot, skipping tombstones, until the owner or an empty slot
+    for (unsigned int i = hashOwnerPointer(owner) & mask; true; i = (i + 1) & mask)
+        if (set->owners[i] == NULL || set->owners[i] == owner)
+            return &set->owners[i];
+}
+
+void addSpeciesOwner(const int id, OwnerNode* owner)
+{
+    SpeciesOwners* set = &speciesOwners[id];
+    // keep at most half of the slots in use (live + tombstones), like the name index
+    if ((set->used + 1) * 2 > set->capacity)
+    {
+        int capacity = set->capacity > 0 ? set->capacity : SPECIES_OWNERS_CAPACITY;
+        while ((set->count + 1) * 2 > capacity / 2)
+            capacity *= 2;
+        resizeSpeciesOwners(set, capacity);
+    }
+    // the owner is not in the set, so the probe ends at an empty slot
+    *findSpeciesOwnerSlot(set, owner) = owner;
+    set->count++;
+    set->used++;
+}
+
+void removeSpeciesOwner(const int id, const OwnerNode* owner)
+{
+    SpeciesOwners* set = &speciesOwners[id];
+    // leave a tombstone, so the probe sequences of other owners stay intact
+    *findSpeciesOwnerSlot(set, owner) = &ownerTombstone;
+    set->count--;
+    // a set that emptied out shrinks, so going over it stays proportional to its size
+    if (set->capacity > SPECIES_OWNERS_CAPACITY && set->count * 8 < set->capacity)
+        resizeSpeciesOwners(set, set->capacity / 4);
+}
+
+void resizeSpeciesOwners(SpeciesOwners* set, const int capacity)
 {
-    // allocate memory for the new PokemonNode
-    PokemonNode* node = malloc(sizeof(PokemonNode));
+    // keep the old slots aside
+    OwnerNode** old = set->owners;
+    const int oldCapacity = set->capacity;
+    // allocate the new, empty slots
+    set->owners = calloc(capacity, sizeof(OwnerNode*));
     // if the allocation has failed, exit the program
-    if (node == NULL)
+    if (set->owners == NULL)
+    {
+        printOutput("Memory allocation failed. (resizeSpeciesOwners: set->owners)\n");
+        exit(1);
+    }
+    set->capacity = capacity;
+    set->used = set->count;
+    // move every live owner into the new slots (tombstones are dropped)
+    for (int i = 0; i < oldCapacity; ++i)
+        if (old[i] != NULL && old[i] != &ownerTombstone)
+            *findSpeciesOwnerSlot(set, old[i]) = old[i];
+    // free the old slots
+    free(old);
+}
+
+int countSpeciesOwners(const int id)
+{
+    // the size of the set is kept up to date
+    return id < 0 || id >= POKEDEX_LENGTH ? 0 : speciesOwners[id].count;
+}
+
+int collectSpeciesOwners(const int id, OwnerNode** owners)
+{
+    // go over the slots of the set, which are at most 8 times as many as the owners in it
+    int count = 0;
+    const SpeciesOwners* set = &speciesOwners[id];
+    for (int i = 0; i < set->capacity; ++i)
+        if (set->owners[i] != NULL && set->owners[i] != &ownerTombstone)
+            owners[count++] = set->owners[i];
+    return count;
+}
+
+int compareOwnersByPosition(const void* a, const void* b)
+{
+    // compare owners by their position in the list
+    const OwnerNode* ownerA = *(OwnerNode* const*)a;
+    const OwnerNode* ownerB = *(OwnerNode* const*)b;
+    return (ownerA->position > ownerB->position) - (ownerA->position < ownerB->position);
+}
+
+void printSpeciesOwners(const int id)
+{
+    // if the ID is invalid, inform the user and return
+    if (id > POKEDEX_LENGTH || id < 1)
+    {
+        printOutput("Invalid ID.\n");
+        return;
+    }
+    // take the owners straight from the index, and print them in the order of the list
+    pthread_mutex_lock(&speciesLock);
+    const int count = countSpeciesOwners(id - 1);
+    OwnerNode** owners = malloc((count > 0 ? count : 1) * sizeof(OwnerNode*));
+    // if the allocation has failed, exit the program
+    if (owners == NULL)
     {
-        printf("Memory allocation failed. (createPokemonNode: node)\n");
+        printOutput("Memory allocation failed. (printSpeciesOwners: owners)\n");
         exit(1);
     }
+    collectSpeciesOwners(id - 1, owners);
+    pthread_mutex_unlock(&speciesLock);
+    printOutput("Owners of %s (ID %d): %d\n", pokedex[id - 1].name, id, count);
+    qsort(owners, count, sizeof(OwnerNode*), compareOwnersByPosition);
+    for (int i = 0; i < count; ++i)
+        printOutput("%d. %s\n", owners[i]->position + 1, owners[i]->ownerName);
+    free(owners);
+}
+
+void freeSpeciesOwners(void)
+{
+    // free the slots of every set, and empty it
+    for (int id = 0; id < POKEDEX_LENGTH; ++id)
+    {
+        free(speciesOwners[id].owners);
+        speciesOwners[id].owners = NULL;
+        speciesOwners[id].capacity = speciesOwners[id].count = speciesOwners[id].used = 0;
+    }
+}
+
+PokemonNode* createPokemonNode(const PokemonData* data)
+{
+    // take memory for the new PokemonNode from the node pool
+    PokemonNode* node = allocPoolObject(&pokemonPool);
     // set the details of the PokemonNode
     node->data = data;
     node->left = node->right = NULL;
+    // a leaf's aggregates are just its own data
+    updatePokemonNode(node);
     // return the newly created PokemonNode
     return node;
 }
+
+void reserveOwners(const int count)
+{
+    // grow the owner table once, instead of doubling it again and again
+    if (count > ownerTable.capacity)
+    {
+        ownerTable.owners = realloc(ownerTable.owners, count * sizeof(OwnerNode*));
+        // if the allocation has failed, exit the program
+        if (ownerTable.owners == NULL)
+        {
+            printOutput("Memory reallocation failed. (reserveOwners: ownerTable.owners)\n");
+            exit(1);
+        }
+        ownerTable.capacity = count;
+    }
+    // size the name index like indexOwner would, so it is never rehashed on the way
+    int capacity = ownerIndex.capacity > 0 ? ownerIndex.capacity : DEFAULT_CAPACITY;
+    while (count * 2 > capacity / 2)
+        capacity *= 2;
+    if (capacity > ownerIndex.capacity)
+        resizeOwnerIndex(capacity);
+}
+
+bool saveSnapshot(const char* path)
+{
+    // measure the snapshot: the header, then a length, a name and a bitmap for every owner
+    size_t size = sizeof(SnapshotHeader);
+    for (int i = 0; i < ownerCount; ++i)
+        size += sizeof(uint32_t) + strlen(ownerTable.owners[i]->ownerName) + SNAPSHOT_SPECIES_SIZE;
+    char* data = malloc(size);
+    // if the allocation has failed, exit the program
+    if (data == NULL)
+    {
+        printOutput("Memory allocation failed. (saveSnapshot: data)\n");
+        exit(1);
+    }
+    // fill the header
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.ownerCount = ownerCount;
+    header.flags = keepOwnersSorted ? SNAPSHOT_KEEP_SORTED : 0;
+    header.generation = journal.generation;
+    memcpy(data, &header, sizeof(header));
+    // fill the owners, in the order of the list (the records are packed, so they are copied)
+    char* cursor = data + sizeof(header);
+    for (int i = 0; i < ownerCount; ++i)
+    {
+        const OwnerNode* owner = ownerTable.owners[i];
+        const uint32_t length = strlen(owner->ownerName);
+        memcpy(cursor, &length, sizeof(length));
+        cursor += sizeof(length);
+        memcpy(cursor, owner->ownerName, length);
+        cursor += length;
+        memcpy(cursor, owner->species, SNAPSHOT_SPECIES_SIZE);
+        cursor += SNAPSHOT_SPECIES_SIZE;
+    }
+    // write a temporary file first, so a failed save never destroys an older snapshot
+    char* temp = malloc(strlen(path) + sizeof(".tmp"));
+    // if the allocation has failed, exit the program
+    if (temp == NULL)
+    {
+        printOutput("Memory allocation failed. (saveSnapshot: temp)\n");
+        exit(1);
+    }
+    strcpy(temp, path);
+    strcat(temp, ".tmp");
+    const int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool saved = fd >= 0 && writeAll(fd, data, size) && fsync(fd) == 0;
+    if (fd >= 0 && close(fd) != 0)
+        saved = false;
+    // then replace the snapshot with it in one step, and make the rename itself durable
+    if (saved && (rename(temp, path) != 0 || !syncParentDirectory(path)))
+        saved = false;
+    // inform the user
+    if (saved)
+        printOutput("Saved %d owners to %s.\n", ownerCount, path);
+    else
+    {
+        printOutput("Failed to save snapshot: %s\n", strerror(errno));
+        unlink(temp);
+    }
+    // free the buffers
+    free(temp);
+    free(data);
+    return saved;
+}
+
+const char* checkSnapshot(const char* data, const size_t size)
+{
+    // check the header
+    SnapshotHeader header;
+    if (size < sizeof(header))
+        return "too short";
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+        return "not a snapshot";
+    if (header.version != SNAPSHOT_VERSION)
+        return "unsupported version";
+    if (header.ownerCount > (size - sizeof(header)) / (sizeof(uint32_t) + SNAPSHOT_SPECIES_SIZE))
+        return "truncated";
+    // check that every record fits, and that no bit past the Pokedex is set
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < header.ownerCount; ++i)
+    {
+        uint32_t length;
+        if (size - offset < sizeof(length))
+            return "truncated";
+        memcpy(&length, data + offset, sizeof(length));
+        offset += sizeof(length);
+        if (size - offset < (size_t)length + SNAPSHOT_SPECIES_SIZE)
+            return "truncated";
+        if (memchr(data + offset, '\0', length) != NULL)
+            return "invalid name";
+        offset += length;
+        unsigned long long species[SPECIES_WORDS];
+        memcpy(species, data + offset, SNAPSHOT_SPECIES_SIZE);
+        offset += SNAPSHOT_SPECIES_SIZE;
+        for (int id = POKEDEX_LENGTH; id < SPECIES_WORDS * SPECIES_WORD_BITS; ++id)
+            if ((species[id / SPECIES_WORD_BITS] >> (id % SPECIES_WORD_BITS)) & 1ULL)
+                return "invalid species";
+    }
+    if (offset != size)
+        return "trailing data";
+    // the snapshot is valid
+    return NULL;
+}
+
+bool syncParentDirectory(const char* path)
+{
+    // the directory is everything before the last slash ("." if there is none, "/" if it is the first char)
+    const char* slash = strrchr(path, '/');
+    const size_t length = slash == NULL || slash == path ? 1 : (size_t)(slash - path);
+    char* directory = malloc(length + 1);
+    // if the allocation has failed, exit the program
+    if (directory == NULL)
+    {
+        printOutput("Memory allocation failed. (syncParentDirectory: directory)\n");
+        exit(1);
+    }
+    memcpy(directory, slash == NULL ? "." : path, length);
+    directory[length] = '\0';
+    // fsync the directory, so the entry the rename changed is on the disk too
+    const int fd = open(directory, O_RDONLY);
+    bool synced = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0 && close(fd) != 0)
+        synced = false;
+    free(directory);
+    return synced;
+}
+
+bool loadSnapshot(const char* path, uint32_t* generation)
+{
+    // map the whole snapshot
+    const int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        printOutput("Failed to load snapshot: %s\n", strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    const size_t size = info.st_size;
+    const char* data = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        printOutput("Failed to load snapshot: %s\n", strerror(errno));
+        return false;
+    }
+    addCounter(COUNTER_BYTES_READ, size);
+    // check all of it before touching the current owners
+    const char* problem = checkSnapshot(data, size);
+    if (problem != NULL)
+    {
+        printOutput("Invalid snapshot: %s\n", problem);
+        if (data != NULL)
+            munmap((void*)data, size);
+        return false;
+    }
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (generation != NULL)
+        *generation = header.generation;
+    // the snapshot replaces the current owners
+    freePokdexes(&ownersHead);
+    ownersSorted = true;
+    // append the owners in their saved order, with everything sized up front
+    keepOwnersSorted = false;
+    reserveOwners(header.ownerCount);
+    const char* cursor = data + sizeof(header);
+    PokemonNode* nodes[POKEDEX_LENGTH];
+    int skipped = 0;
+    for (uint32_t i = 0; i < header.ownerCount; ++i)
+    {
+        uint32_t length;
+        memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        // the owner keeps its own copy of the name
+        char* name = malloc(length + 1);
+        // if the allocation has failed, exit the program
+        if (name == NULL)
+        {
+            printOutput("Memory allocation failed. (loadSnapshot: name)\n");
+            exit(1);
+        }
+        memcpy(name, cursor, length);
+        name[length] = '\0';
+        cursor += length;
+        // a name that is already taken is skipped, like in newPokedex
+        // (the index is already big enough, so the slot the probe ends at is where the owner goes)
+        const unsigned int hash = hashOwnerName(name);
+        OwnerIndexEntry* entry = findOwnerIndexEntry(name, hash);
+        if (entry->owner != NULL)
+        {
+            free(name);
+            cursor += SNAPSHOT_SPECIES_SIZE;
+            skipped++;
+            continue;
+        }
+        OwnerNode* owner = createOwner(name, NULL);
+        unsigned long long species[SPECIES_WORDS];
+        memcpy(species, cursor, SNAPSHOT_SPECIES_SIZE);
+        replaceSpecies(owner, species);
+        cursor += SNAPSHOT_SPECIES_SIZE;
+        // the bitmap lists the species by ID, so the BST is built balanced in one go
+        int count = 0;
+        for (int word = 0; word < SPECIES_WORDS; ++word)
+            for (unsigned long long bits = owner->species[word]; bits != 0; bits &= bits - 1)
+                nodes[count++] = createPokemonNode(&pokedex[word * SPECIES_WORD_BITS + lowestBit(bits)]);
+        owner->pokedexRoot = buildBalancedTree(nodes, count);
+        // add the owner like addOwner, but into the slot that was already found
+        linkOwnerInCircularList(owner);
+        publishPokedex(owner);
+        STORE_RELAXED(&entry->hash, hash);
+        STORE_RELEASE(&entry->owner, owner);
+        ownerIndex.used++;
+        ownerCount++;
+    }
+    // keep the owners sorted only if the snapshot asks for it and really is sorted
+    keepOwnersSorted = (header.flags & SNAPSHOT_KEEP_SORTED) && ownersSorted;
+    // unmap the snapshot, and inform the user
+    munmap((void*)data, size);
+    printOutput("Loaded %d owners from %s.\n", ownerCount, path);
+    if (skipped > 0)
+        printOutput("Skipped %d owners with duplicate names.\n", skipped);
+    return true;
+}
+
+void loadSnapshotCommand(const char* path)
+{
+    // a loaded snapshot is not in the journal, so it becomes the new base of the journal
+    if (!loadSnapshot(path, NULL) || journal.fd < 0 || compactJournal())
+        return;
+    // else, the journal still describes the owners from before the load, and a restart would quietly bring
+    // them back, so stop here, loudly, while the journal and the files on the disk still agree
+    flushOutput();
+    fprintf(stderr, "Failed to make the loaded snapshot the base of the journal. "
+            "The journal still holds the state from before the load.\n");
+    _exit(1);
+}
+
+bool parseFsyncPolicy(const char* arg, FsyncPolicy* policy)
+{
+    // match the name of the policy
+    if (strcmp(arg, "always") == 0)
+        *policy = FSYNC_ALWAYS;
+    else if (strcmp(arg, "batch") == 0)
+        *policy = FSYNC_BATCH;
+    else if (strcmp(arg, "never") == 0)
+        *policy = FSYNC_NEVER;
+    else
+        return false;
+    return true;
+}
+
+bool isJournaling(void)
+{
+    // changes are journaled only when a journal is open, and not while it is being replayed
+    return journal.fd >= 0 && !journal.replaying;
+}
+
+void reserveJournal(const size_t length)
+{
+    // if the buffer is too small, grow it (at least doubling it)
+    if (journal.size + length <= journal.capacity)
+        return;
+    size_t capacity = journal.capacity > 0 ? journal.capacity * 2 : JOURNAL_GROUP_BYTES;
+    while (capacity < journal.size + length)
+        capacity *= 2;
+    journal.data = realloc(journal.data, capacity);
+    // if the allocation has failed, exit the program
+    if (journal.data == NULL)
+    {
+        printOutput("Memory reallocation failed. (reserveJournal: journal.data)\n");
+        exit(1);
+    }
+    journal.capacity = capacity;
+}
+
+void beginJournalRecord(const JournalRecordType type)
+{
+    // the record is written as a whole, while no other thread writes one
+    pthread_mutex_lock(&journalLock);
+    // leave room for the length and the checksum, which are known only at the end
+    journal.recordStart = journal.size;
+    reserveJournal(2 * sizeof(uint32_t) + 1);
+    journal.size += 2 * sizeof(uint32_t);
+    journal.data[journal.size++] = (char)type;
+}
+
+void writeJournalName(const char* name)
+{
+    // names are stored with their null char, so they can be used in place when replayed
+    const size_t length = strlen(name) + 1;
+    reserveJournal(length);
+    memcpy(journal.data + journal.size, name, length);
+    journal.size += length;
+}
+
+void writeJournalInt(const int value)
+{
+    const int32_t stored = value;
+    reserveJournal(sizeof(stored));
+    memcpy(journal.data + journal.size, &stored, sizeof(stored));
+    journal.size += sizeof(stored);
+}
+
+void endJournalRecord(void)
+{
+    // fill in the length and the checksum of the body (the type and the fields)
+    const char* body = journal.data + journal.recordStart + 2 * sizeof(uint32_t);
+    const uint32_t length = journal.data + journal.size - body;
+    const uint32_t checksum = checksumJournalRecord(body, length);
+    memcpy(journal.data + journal.recordStart, &length, sizeof(length));
+    memcpy(journal.data + journal.recordStart + sizeof(length), &checksum, sizeof(checksum));
+    // commit right away, or once a whole group of records has piled up
+    const bool commit = journal.policy == FSYNC_ALWAYS || journal.size >= JOURNAL_GROUP_BYTES;
+    pthread_mutex_unlock(&journalLock);
+    if (commit)
+        commitJournal();
+}
+
+void journalOwnerChange(const JournalRecordType type, const char* name, const int value)
+{
+    // if nothing is journaled, there is nothing to do
+    if (!isJournaling())
+        return;
+    // write the record, with only the fields its type uses
+    beginJournalRecord(type);
+    if (type != JOURNAL_SORT && type != JOURNAL_KEEP_SORTED)
+        writeJournalName(name);
+    if (type == JOURNAL_NEW || type == JOURNAL_ADD || type == JOURNAL_RELEASE || type == JOURNAL_EVOLVE)
+        writeJournalInt(value);
+    endJournalRecord();
+}
+
+unsigned int checksumJournalRecord(const char* body, const size_t length)
+{
+    // FNV-1a over the bytes of the body, like the owner names
+    unsigned int hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (unsigned char)body[i]) * FNV_PRIME;
+    return hash;
+}
+
+void commitJournal(void)
+{
+    // if nothing is waiting, there is nothing to commit
+    pthread_mutex_lock(&journalLock);
+    if (journal.fd < 0 || journal.size == 0)
+    {
+        pthread_mutex_unlock(&journalLock);
+        return;
+    }
+    // write the whole group at once, then make it durable (unless the policy says not to)
+    if (!writeAll(journal.fd, journal.data, journal.size)
+        || (journal.policy != FSYNC_NEVER && fdatasync(journal.fd) != 0))
+    {
+        // a change that cannot be journaled must not be acknowledged
+        fprintf(stderr, "Failed to write the journal: %s\n", strerror(errno));
+        _exit(1);
+    }
+    // the buffer is empty again
+    journal.size = 0;
+    pthread_mutex_unlock(&journalLock);
+}
+
+bool resetJournalFile(void)
+{
+    // empty the file, and start it over with a header of the current generation
+    JournalHeader header;
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.generation = journal.generation;
+    return ftruncate(journal.fd, 0) == 0
+        && writeAll(journal.fd, (const char*)&header, sizeof(header))
+        && (journal.policy == FSYNC_NEVER || fdatasync(journal.fd) == 0);
+}
+
+bool openJournal(const char* path, const FsyncPolicy policy)
+{
+    journal.policy = policy;
+    // the journal has its own snapshot next to it (FILE.snap), which is loaded first if it exists
+    journal.snapshotPath = malloc(strlen(path) + sizeof(".snap"));
+    // if the allocation has failed, exit the program
+    if (journal.snapshotPath == NULL)
+    {
+        printOutput("Memory allocation failed. (openJournal: journal.snapshotPath)\n");
+        exit(1);
+    }
+    strcpy(journal.snapshotPath, path);
+    strcat(journal.snapshotPath, ".snap");
+    uint32_t generation = 0;
+    if (access(journal.snapshotPath, F_OK) == 0 && !loadSnapshot(journal.snapshotPath, &generation))
+        return false;
+    journal.generation = generation;
+    // open (or create) the journal, for appending only
+    journal.fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat info;
+    if (journal.fd < 0 || fstat(journal.fd, &info) != 0)
+    {
+        printOutput("Failed to open journal: %s\n", strerror(errno));
+        return false;
+    }
+    // a new journal only needs its header
+    if (info.st_size == 0)
+        return resetJournalFile();
+    // map the journal, and check its header
+    const size_t size = info.st_size;
+    const char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, journal.fd, 0);
+    if (data == MAP_FAILED)
+    {
+        printOutput("Failed to open journal: %s\n", strerror(errno));
+        return false;
+    }
+    addCounter(COUNTER_BYTES_READ, size);
+    JournalHeader header;
+    bool opened = true;
+    if (size >= sizeof(header))
+        memcpy(&header, data, sizeof(header));
+    if (size < sizeof(header) || memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0
+        || header.version != JOURNAL_VERSION)
+    {
+        printOutput("Invalid journal: %s\n", path);
+        opened = false;
+    }
+    // an older journal was already compacted into the snapshot, so it is dropped
+    else if (header.generation < generation)
+        opened = resetJournalFile();
+    // a newer journal has lost the snapshot it was written on top of
+    else if (header.generation > generation)
+    {
+        printOutput("Invalid journal: %s is newer than its snapshot\n", path);
+        opened = false;
+    }
+    // else, replay it, and cut off whatever was torn at its end
+    else
+    {
+        const size_t end = replayJournal(data, size);
+        opened = end == size || ftruncate(journal.fd, end) == 0;
+    }
+    munmap((void*)data, size);
+    return opened;
+}
+
+size_t replayJournal(const char* data, const size_t size)
+{
+    // the output of the replayed changes was already seen when they were made
+    size_t mark = output.size;
+    journal.replaying = true;
+    size_t offset = sizeof(JournalHeader);
+    int count = 0, skipped = 0;
+    while (size - offset >= 2 * sizeof(uint32_t))
+    {
+        // stop at the first record that is torn or damaged (only that, and what follows it, is cut off)
+        uint32_t length, checksum;
+        memcpy(&length, data + offset, sizeof(length));
+        memcpy(&checksum, data + offset + sizeof(length), sizeof(checksum));
+        const char* body = data + offset + 2 * sizeof(uint32_t);
+        if (length == 0 || length > size - offset - 2 * sizeof(uint32_t)
+            || checksumJournalRecord(body, length) != checksum)
+            break;
+        offset += 2 * sizeof(uint32_t) + length;
+        // an intact record that does not apply to the current owners is reported and skipped, not cut off
+        const bool applied = applyJournalRecord(body, length);
+        output.size = mark;
+        if (applied)
+            count++;
+        else
+        {
+            skipped++;
+            printOutput("Skipped journal record %d: it does not apply to the current owners.\n", count + skipped);
+            mark = output.size;
+        }
+    }
+    output.size = mark;
+    journal.replaying = false;
+    // inform the user
+    printOutput("Replayed %d journal records.\n", count);
+    if (offset < size)
+        printOutput("Dropped %zu damaged bytes at the end of the journal.\n", size - offset);
+    return offset;
+}
+
+const char* readJournalName(JournalReader* reader)
+{
+    // the name runs up to its null char, which must be inside the record
+    const char* end = reader->valid ? memchr(reader->cursor, '\0', reader->end - reader->cursor) : NULL;
+    if (end == NULL)
+    {
+        reader->valid = false;
+        return "";
+    }
+    const char* name = reader->cursor;
+    reader->cursor = end + 1;
+    return name;
+}
+
+int readJournalInt(JournalReader* reader)
+{
+    int32_t value = 0;
+    // the value must be inside the record
+    if (!reader->valid || reader->end - reader->cursor < (ptrdiff_t)sizeof(value))
+    {
+        reader->valid = false;
+        return 0;
+    }
+    memcpy(&value, reader->cursor, sizeof(value));
+    reader->cursor += sizeof(value);
+    return value;
+}
+
+bool applyJournalRecord(const char* body, const size_t length)
+{
+    // read the fields of the record, as its type says
+    JournalReader reader = {body + 1, body + length, true};
+    const JournalRecordType type = (unsigned char)body[0];
+    const char* name = "";
+    const char* other = "";
+    int value = 0;
+    if (type != JOURNAL_SORT && type != JOURNAL_KEEP_SORTED)
+        name = readJournalName(&reader);
+    if (type == JOURNAL_MERGE)
+        other = readJournalName(&reader);
+    // a merge of many owners has a count, and then that many names
+    OwnerNode** sources = NULL;
+    int sourceCount = 0;
+    bool found = true;
+    if (type == JOURNAL_MERGE_MANY)
+    {
+        sourceCount = readJournalInt(&reader);
+        if (sourceCount <= 0 || sourceCount > (int)length)
+            return false;
+        sources = malloc(sourceCount * sizeof(OwnerNode*));
+        // if the allocation has failed, exit the program
+        if (sources == NULL)
+        {
+            printOutput("Memory allocation failed. (applyJournalRecord: sources)\n");
+            exit(1);
+        }
+        for (int i = 0; i < sourceCount; ++i)
+            found = (sources[i] = findOwnerByName(readJournalName(&reader))) != NULL && found;
+    }
+    if (type == JOURNAL_NEW || type == JOURNAL_ADD || type == JOURNAL_RELEASE || type == JOURNAL_EVOLVE)
+        value = readJournalInt(&reader);
+    // the fields must fill the record exactly
+    if (!reader.valid || reader.cursor != reader.end || !found)
+    {
+        free(sources);
+        return false;
+    }
+    // redo the change through the same functions that made it
+    OwnerNode* owner = findOwnerByName(name);
+    switch (type)
+    {
+    case JOURNAL_NEW:
+        if (owner != NULL || value < 0 || value >= POKEDEX_LENGTH)
+            return false;
+        createPokedex(copyString(name), &pokedex[value]);
+        return true;
+    case JOURNAL_ADD:
+    case JOURNAL_RELEASE:
+    case JOURNAL_EVOLVE:
+    case JOURNAL_EVOLVE_ALL:
+        if (owner == NULL)
+            return false;
+        if (type == JOURNAL_EVOLVE_ALL)
+            evolveAllPokemon(owner);
+        else if (type == JOURNAL_ADD)
+            addPokemonByID(owner, value);
+        else if (type == JOURNAL_RELEASE)
+            releasePokemonByID(owner, value);
+        else
+            evolvePokemonByID(owner, value);
+        return true;
+    case JOURNAL_MERGE:
+        if (owner == NULL || findOwnerByName(other) == NULL)
+            return false;
+        mergeOwners(owner, findOwnerByName(other));
+        return true;
+    case JOURNAL_DELETE:
+        if (owner == NULL)
+            return false;
+        deleteOwner(owner);
+        return true;
+    case JOURNAL_MERGE_MANY:
+        if (owner != NULL)
+            mergeManyOwners(owner, sources, sourceCount);
+        free(sources);
+        return owner != NULL;
+    case JOURNAL_SORT:
+        sortOwners();
+        return true;
+    case JOURNAL_KEEP_SORTED:
+        toggleKeepOwnersSorted();
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool compactJournal(void)
+{
+    // if there is no journal, inform the user and return
+    if (journal.fd < 0)
+    {
+        printOutput("No journal is open.\n");
+        return false;
+    }
+    // whatever is waiting goes into the old generation first
+    commitJournal();
+    // the snapshot of the next generation makes every record so far redundant
+    journal.generation++;
+    if (!saveSnapshot(journal.snapshotPath))
+    {
+        journal.generation--;
+        return false;
+    }
+    // start the journal over (if this fails, the old journal is dropped on the next start anyway)
+    if (!resetJournalFile())
+    {
+        fprintf(stderr, "Failed to write the journal: %s\n", strerror(errno));
+        _exit(1);
+    }
+    printOutput("Journal compacted.\n");
+    return true;
+}
+
+void closeJournal(void)
+{
+    // commit whatever is waiting, then close the file
+    commitJournal();
+    if (journal.fd >= 0)
+        close(journal.fd);
+    journal.fd = -1;
+    // free the buffers
+    free(journal.data);
+    free(journal.snapshotPath);
+    journal.data = journal.snapshotPath = NULL;
+    journal.size = journal.capacity = 0;
+}
+
+bool readAll(const int fd, char* data, const size_t length)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        const ssize_t result = read(fd, data + done, length - done);
+        // retry if interrupted, give up at the end of the stream or on any other error
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        done += result;
+        addCounter(COUNTER_BYTES_READ, result);
+    }
+    return true;
+}
+
+bool writeFrame(const int fd, const char* data, const uint32_t length)
+{
+    // the length first, then the bytes
+    return writeAll(fd, (const char*)&length, sizeof(length)) && writeAll(fd, data, length);
+}
+
+bool readFrame(const int fd, char** data, size_t* capacity, uint32_t* length, const uint32_t maxLength)
+{
+    // read the length, and refuse frames that are too long
+    if (!readAll(fd, (char*)length, sizeof(*length)) || *length > maxLength)
+        return false;
+    // make room for the bytes and a null char (at least doubling the buffer)
+    if (*length + 1 > *capacity)
+    {
+        size_t grown = *capacity > 0 ? *capacity * 2 : DEFAULT_CAPACITY;
+        while (grown < *length + 1)
+            grown *= 2;
+        char* buffer = realloc(*data, grown);
+        // if the allocation has failed, exit the program
+        if (buffer == NULL)
+        {
+            printOutput("Memory reallocation failed. (readFrame: data)\n");
+            exit(1);
+        }
+        *data = buffer;
+        *capacity = grown;
+    }
+    // read the bytes, and end them with a null char so a request can be used as a string
+    if (!readAll(fd, *data, *length))
+        return false;
+    (*data)[*length] = '\0';
+    return true;
+}
+
+bool makeSocketAddress(const char* path, struct sockaddr_un* address)
+{
+    // the path must fit in the address, with its null char
+    if (strlen(path) >= sizeof(address->sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return false;
+    }
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+void stopServer(const int signal)
+{
+    // only raise the flag, the main thread stops between two connections
+    (void)signal;
+    serverStopping = 1;
+}
+
+bool runServer(const char* path)
+{
+    // listen on the socket (a socket file left by an earlier server is replaced)
+    struct sockaddr_un address;
+    if (!makeSocketAddress(path, &address))
+        return false;
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (listener < 0 || bind(listener, (const struct sockaddr*)&address, sizeof(address)) != 0
+        || listen(listener, SERVER_BACKLOG) != 0)
+    {
+        fprintf(stderr, "Failed to listen on %s: %s\n", path, strerror(errno));
+        if (listener >= 0)
+            close(listener);
+        return false;
+    }
+    // a client that hangs up must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+    // SIGINT and SIGTERM stop the server, but they are only let in while waiting for a connection
+    // (the clients' threads inherit the blocked mask, so the signals always reach this thread)
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServer;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    sigset_t stopSignals, waiting;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, &waiting);
+    sigdelset(&waiting, SIGINT);
+    sigdelset(&waiting, SIGTERM);
+    printOutput("Listening on %s\n", path);
+    flushOutput();
+    // serve every client on a thread of its own, until the server is stopped
+    while (!serverStopping)
+    {
+        fd_set ready;
+        FD_ZERO(&ready);
+        FD_SET(listener, &ready);
+        if (pselect(listener + 1, &ready, NULL, NULL, NULL, &waiting) <= 0)
+            continue;
+        const int client = accept(listener, NULL, NULL);
+        if (client < 0)
+            continue;
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serveClient, (void*)(intptr_t)client) == 0)
+            pthread_detach(thread);
+        else
+            close(client);
+    }
+    // wait for the commands that are running, and keep every client out from now on (the owners are freed next)
+    pthread_rwlock_wrlock(&ownersLock);
+    close(listener);
+    unlink(path);
+    printOutput("Server stopped.\n");
+    return true;
+}
+
+void* serveClient(void* arg)
+{
+    const int client = (int)(intptr_t)arg;
+    // the results of the commands of this client go back to it, one frame per flush
+    output.fd = client;
+    output.framed = true;
+    char* request = NULL;
+    size_t capacity = 0;
+    uint32_t length;
+    // run every request as a batch command, and end its results with an empty frame
+    while (readFrame(client, &request, &capacity, &length, SERVER_MAX_REQUEST))
+    {
+        runBatchCommand(request);
+        flushOutput();
+        if (!writeFrame(client, NULL, 0))
+            break;
+    }
+    // free the buffers of the thread, and hang up
+    free(request);
+    free(output.data);
+    freePokemonQueue(&levelQueue);
+    releaseEpochRecord();
+    releaseCounterSet();
+    close(client);
+    return NULL;
+}
+
+int connectToServer(const char* path)
+{
+    // connect to the socket of the server
+    struct sockaddr_un address;
+    if (!makeSocketAddress(path, &address))
+        return -1;
+    const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || connect(server, (const struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        fprintf(stderr, "Failed to connect to %s: %s\n", path, strerror(errno));
+        if (server >= 0)
+            close(server);
+        return -1;
+    }
+    return server;
+}
+
+bool sendRequest(const int server, const char* command, char** reply, size_t* capacity, const bool show)
+{
+    // send the command, then read the frames of the results until the empty one
+    uint32_t length;
+    if (!writeFrame(server, command, strlen(command)))
+        return false;
+    while (readFrame(server, reply, capacity, &length, UINT32_MAX))
+    {
+        if (length == 0)
+            return true;
+        if (show)
+            writeOutput(*reply, length);
+    }
+    return false;
+}
+
+bool runClient(const char* path)
+{
+    const int server = connectToServer(path);
+    if (server < 0)
+        return false;
+    // a client that hangs up must not kill the client
+    signal(SIGPIPE, SIG_IGN);
+    // send every line of the input as a command, and print its results
+    char* reply = NULL;
+    size_t capacity = 0;
+    bool connected = true;
+    const char* line;
+    while (connected && (line = readLine()) != NULL)
+    {
+        connected = sendRequest(server, line, &reply, &capacity, true);
+        // write the results in big chunks
+        if (output.size >= OUTPUT_CAPACITY)
+            flushOutput();
+    }
+    if (!connected)
+        printOutput("Connection to the server lost.\n");
+    free(reply);
+    close(server);
+    return connected;
+}
+
+bool runLoadClients(const char* path, const int clients, const int requests)
+{
+    LoadClient* loaders = calloc(clients, sizeof(LoadClient));
+    // if the allocation has failed, exit the program
+    if (loaders == NULL)
+    {
+        printOutput("Memory allocation failed. (runLoadClients: loaders)\n");
+        exit(1);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    // start every client on a thread of its own, and wait for all of them
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < clients; ++i)
+    {
+        loaders[i].path = path;
+        loaders[i].index = i;
+        loaders[i].requests = requests;
+        loaders[i].started = pthread_create(&loaders[i].thread, NULL, runLoadClient, &loaders[i]) == 0;
+        if (!loaders[i].started)
+            loaders[i].failed = true;
+    }
+    int failed = 0;
+    for (int i = 0; i < clients; ++i)
+    {
+        if (loaders[i].started)
+            pthread_join(loaders[i].thread, NULL);
+        failed += loaders[i].failed;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    // report the throughput of the clients that got through
+    const double seconds = (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    const long sent = (long)(clients - failed) * (requests + 2);
+    printOutput("%d clients sent %ld requests in %.3f s (%.0f requests/s).\n", clients - failed, sent, seconds,
+                seconds > 0 ? sent / seconds : 0.0);
+    if (failed > 0)
+        printOutput("%d clients failed.\n", failed);
+    free(loaders);
+    return failed == 0;
+}
+
+void* runLoadClient(void* arg)
+{
+    LoadClient* loader = arg;
+    const int server = connectToServer(loader->path);
+    if (server < 0)
+    {
+        loader->failed = true;
+        return NULL;
+    }
+    // every client changes an owner of its own, and reads the owners of the others now and then
+    char name[DEFAULT_CAPACITY], command[2 * DEFAULT_CAPACITY];
+    snprintf(name, sizeof(name), "load-%d", loader->index);
+    unsigned int seed = loader->index + 1;
+    char* reply = NULL;
+    size_t capacity = 0;
+    snprintf(command, sizeof(command), "new %s %d", name, loader->index % 3 + 1);
+    bool connected = sendRequest(server, command, &reply, &capacity, false);
+    for (int i = 0; i < loader->requests && connected; ++i)
+    {
+        const int id = rand_r(&seed) % POKEDEX_LENGTH + 1;
+        const int other = rand_r(&seed) % POKEDEX_LENGTH + 1;
+        switch (rand_r(&seed) % 8)
+        {
+        case 0:
+            snprintf(command, sizeof(command), "add %s %d", name, id);
+            break;
+        case 1:
+            snprintf(command, sizeof(command), "release %s %d", name, id);
+            break;
+        case 2:
+            snprintf(command, sizeof(command), "display %s in", name);
+            break;
+        case 3:
+            snprintf(command, sizeof(command), "stats %s", name);
+            break;
+        case 4:
+            snprintf(command, sizeof(command), "fight %s %d %d", name, id, other);
+            break;
+        case 5:
+            snprintf(command, sizeof(command), "range %s %d %d", name, id, id + 20);
+            break;
+        case 6:
+            snprintf(command, sizeof(command), "display load-%d pre", (int)(rand_r(&seed) % 64));
+            break;
+        default:
+            snprintf(command, sizeof(command), "owners %d", id);
+            break;
+        }
+        connected = sendRequest(server, command, &reply, &capacity, false);
+    }
+    // clean up after the client
+    snprintf(command, sizeof(command), "delete %s", name);
+    loader->failed = !connected || !sendRequest(server, command, &reply, &capacity, false);
+    free(reply);
+    close(server);
+    releaseCounterSet();
+    return NULL;
+}
+
+void initBenchConfig(BenchConfig* config)
+{
+    // a mix of reads and changes of single owners, with a merge or a sort now and then
+    static const int weights[BENCH_POPULATE] = {20, 10, 5, 10, 15, 10, 15, 5, 5, 5};
+    config->seed = BENCH_SEED;
+    config->owners = BENCH_OWNERS;
+    config->pokemon = BENCH_POKEMON;
+    config->operations = BENCH_OPERATIONS;
+    memcpy(config->weights, weights, sizeof(weights));
+    config->ids = BENCH_IDS_UNIFORM;
+}
+
+bool parseBenchMix(const char* arg, int* weights)
+{
+    // only the listed operation types run
+    for (int op = 0; op < BENCH_POPULATE; ++op)
+        weights[op] = 0;
+    long total = 0;
+    while (*arg != '\0')
+    {
+        // every item is NAME=WEIGHT, and the items are separated by commas
+        const char* equals = strchr(arg, '=');
+        if (equals == NULL)
+            return false;
+        const size_t length = equals - arg;
+        int op = 0;
+        while (op < BENCH_POPULATE && (strlen(getBenchOpName(op)) != length
+            || strncmp(arg, getBenchOpName(op), length) != 0))
+            op++;
+        char* end;
+        const long weight = strtol(equals + 1, &end, 10);
+        if (op == BENCH_POPULATE || end == equals + 1 || (*end != ',' && *end != '\0') || weight < 0
+            || weight > BENCH_MAX_WEIGHT)
+            return false;
+        weights[op] = (int)weight;
+        total += weight;
+        arg = *end == ',' ? end + 1 : end;
+    }
+    return total > 0;
+}
+
+bool parseBenchIDs(const char* arg, BenchIDs* ids)
+{
+    // the names of the distributions, in the order of the enum
+    static const char* const names[] = {"uniform", "sequential", "skewed"};
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); ++i)
+    {
+        if (strcmp(arg, names[i]) == 0)
+        {
+            *ids = (BenchIDs)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* getBenchOpName(const BenchOp op)
+{
+    // the names of the operation types, in the order of the enum
+    static const char* const names[BENCH_OP_COUNT] = {
+        "add", "release", "evolve", "fight", "display", "range", "stats", "owners", "merge", "sort", "populate"
+    };
+    return names[op];
+}
+
+int nextBenchID(BenchGenerator* generator, const int owner)
+{
+    switch (generator->config.ids)
+    {
+    case BENCH_IDS_SEQUENTIAL:
+        // every owner goes through the IDs in order, and starts over after the last one
+        return generator->nextIDs[owner]++ % POKEDEX_LENGTH + 1;
+    case BENCH_IDS_SKEWED:
+    {
+        // cubing a uniform fraction piles the IDs up at the low end
+        const double fraction = rand_r(&generator->seed) / ((double)RAND_MAX + 1);
+        return (int)(fraction * fraction * fraction * POKEDEX_LENGTH) + 1;
+    }
+    default:
+        return (int)(rand_r(&generator->seed) % POKEDEX_LENGTH) + 1;
+    }
+}
+
+BenchOp nextBenchCommand(BenchGenerator* generator, char* line, const size_t size)
+{
+    const BenchConfig* config = &generator->config;
+    // an owner that is being built is created first, then filled one ID at a time
+    if (generator->building >= 0)
+    {
+        const int owner = generator->building;
+        if (generator->added < 0)
+        {
+            snprintf(line, size, "new bench-%d %d", owner, owner % 3 + 1);
+            generator->nextIDs[owner] = 0;
+            generator->added = 0;
+        }
+        else
+        {
+            snprintf(line, size, "add bench-%d %d", owner, nextBenchID(generator, owner));
+            generator->added++;
+        }
+        // when it is full, build the next owner (only at the start are all of them built)
+        if (generator->added >= config->pokemon)
+        {
+            generator->initializing = generator->initializing && owner + 1 < config->owners;
+            generator->building = generator->initializing ? owner + 1 : -1;
+            generator->added = -1;
+        }
+        return BENCH_POPULATE;
+    }
+    // pick the operation type by its weight, and the owner at random
+    int pick = (int)(rand_r(&generator->seed) % generator->totalWeight);
+    int op = 0;
+    while (pick >= config->weights[op])
+        pick -= config->weights[op++];
+    const int owner = (int)(rand_r(&generator->seed) % config->owners);
+    const int id = nextBenchID(generator, owner);
+    switch ((BenchOp)op)
+    {
+    case BENCH_ADD:
+        snprintf(line, size, "add bench-%d %d", owner, id);
+        break;
+    case BENCH_RELEASE:
+        snprintf(line, size, "release bench-%d %d", owner, id);
+        break;
+    case BENCH_EVOLVE:
+        snprintf(line, size, "evolve bench-%d %d", owner, id);
+        break;
+    case BENCH_FIGHT:
+        snprintf(line, size, "fight bench-%d %d %d", owner, id, nextBenchID(generator, owner));
+        break;
+    case BENCH_DISPLAY:
+        snprintf(line, size, "display bench-%d bfs", owner);
+        break;
+    case BENCH_RANGE:
+        snprintf(line, size, "range bench-%d %d %d", owner, id, id + 20);
+        break;
+    case BENCH_STATS:
+        snprintf(line, size, "stats bench-%d", owner);
+        break;
+    case BENCH_SPECIES_OWNERS:
+        snprintf(line, size, "owners %d", id);
+        break;
+    case BENCH_MERGE:
+    {
+        // merge another owner into this one, then build the other owner again, so there are always as many
+        const int other = (owner + 1 + (int)(rand_r(&generator->seed) % (config->owners - 1))) % config->owners;
+        snprintf(line, size, "merge bench-%d bench-%d", owner, other);
+        generator->building = other;
+        generator->added = -1;
+        break;
+    }
+    default:
+        snprintf(line, size, "sort");
+        break;
+    }
+    return (BenchOp)op;
+}
+
+void runBenchmark(const BenchConfig* config, const bool script)
+{
+    BenchGenerator generator = {*config, (unsigned int)config->seed, 0, NULL, 0, -1, true};
+    for (int op = 0; op < BENCH_POPULATE; ++op)
+        generator.totalWeight += config->weights[op];
+    generator.nextIDs = calloc(config->owners, sizeof(int));
+    // if the allocation has failed, exit the program
+    if (generator.nextIDs == NULL)
+    {
+        printOutput("Memory allocation failed. (runBenchmark: generator.nextIDs)\n");
+        exit(1);
+    }
+    LatencyList latencies[BENCH_OP_COUNT];
+    memset(latencies, 0, sizeof(latencies));
+    char line[2 * DEFAULT_CAPACITY];
+    long commands = 0;
+    struct timespec began, finished, start, end;
+    clock_gettime(CLOCK_MONOTONIC, &began);
+    // generate the commands until the mix is done (and the last merged owner is built again)
+    for (int done = 0; done < config->operations || generator.building >= 0; ++commands)
+    {
+        const BenchOp op = nextBenchCommand(&generator, line, sizeof(line));
+        done += op != BENCH_POPULATE;
+        // a script is only printed, to be run later with --batch
+        if (script)
+        {
+            printOutput("%s\n", line);
+            if (output.size >= OUTPUT_CAPACITY)
+                flushOutput();
+            continue;
+        }
+        // time the command, and throw its results away
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        runBatchCommand(line);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        output.size = 0;
+        recordLatency(&latencies[op], (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    free(generator.nextIDs);
+    if (script)
+        return;
+    // report the throughput and the latencies of every operation type that ran
+    static const char* const idNames[] = {"uniform", "sequential", "skewed"};
+    printOutput("Benchmark: seed %d, %d owners, %d Pokemon each, %d operations, %s IDs.\n", config->seed,
+                config->owners, config->pokemon, config->operations, idNames[config->ids]);
+    printOutput("%-10s %9s %12s %10s %10s %10s\n", "operation", "count", "ops/s", "p50 us", "p99 us", "p999 us");
+    for (int op = 0; op < BENCH_OP_COUNT; ++op)
+    {
+        LatencyList* list = &latencies[op];
+        if (list->count == 0)
+            continue;
+        long long total = 0;
+        for (int i = 0; i < list->count; ++i)
+            total += list->values[i];
+        qsort(list->values, list->count, sizeof(long long), compareLatencies);
+        printOutput("%-10s %9d %12.0f %10.2f %10.2f %10.2f\n", getBenchOpName(op), list->count,
+                    total > 0 ? list->count * 1e9 / total : 0.0, latencyPercentile(list, 500) / 1e3,
+                    latencyPercentile(list, 990) / 1e3, latencyPercentile(list, 999) / 1e3);
+        free(list->values);
+    }
+    const double seconds = (double)(finished.tv_sec - began.tv_sec) + (finished.tv_nsec - began.tv_nsec) / 1e9;
+    printOutput("Ran %ld commands in %.3f s (%.0f commands/s).\n", commands, seconds,
+                seconds > 0 ? commands / seconds : 0.0);
+}
+
+void recordLatency(LatencyList* list, const long long nanoseconds)
+{
+    // grow the list (double it) when it is full
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity > 0 ? list->capacity * 2 : DEFAULT_CAPACITY;
+        list->values = realloc(list->values, list->capacity * sizeof(long long));
+        // if the reallocation has failed, exit the program
+        if (list->values == NULL)
+        {
+            printOutput("Memory reallocation failed. (recordLatency: list->values)\n");
+            exit(1);
+        }
+    }
+    list->values[list->count++] = nanoseconds;
+}
+
+int compareLatencies(const void* a, const void* b)
+{
+    const long long first = *(const long long*)a, second = *(const long long*)b;
+    return (first > second) - (first < second);
+}
+
+long long latencyPercentile(const LatencyList* list, const int perMille)
+{
+    // the smallest latency that at least perMille of the list does not exceed
+    const long rank = ((long)list->count * perMille + 999) / 1000;
+    return list->values[rank > 0 ? rank - 1 : 0];
+}
+
+void addCounter(const CounterKind kind, const unsigned long long amount)
+{
+    // the first count of a thread takes a set of counters
+    if (counterSet == NULL)
+        takeCounterSet();
+    // a plain add: only this thread writes its set (the relaxed accesses let other threads sum it meanwhile)
+    STORE_RELAXED(&counterSet->values[kind], LOAD_RELAXED(&counterSet->values[kind]) + amount);
+}
+
+void takeCounterSet(void)
+{
+    pthread_mutex_lock(&counterLock);
+    // reuse the set of a finished thread, keeping its counts, so nothing that was counted is lost
+    for (CounterSet* set = counterSets; set != NULL && counterSet == NULL; set = set->next)
+    {
+        if (!set->taken)
+        {
+            set->taken = true;
+            counterSet = set;
+        }
+    }
+    // else, link a new one
+    if (counterSet == NULL)
+    {
+        counterSet = calloc(1, sizeof(CounterSet));
+        // if the allocation has failed, exit the program
+        if (counterSet == NULL)
+        {
+            pthread_mutex_unlock(&counterLock);
+            printOutput("Memory allocation failed. (takeCounterSet: counterSet)\n");
+            exit(1);
+        }
+        counterSet->taken = true;
+        counterSet->next = counterSets;
+        counterSets = counterSet;
+    }
+    pthread_mutex_unlock(&counterLock);
+}
+
+void releaseCounterSet(void)
+{
+    // if the thread never counted anything, there is nothing to give back
+    if (counterSet == NULL)
+        return;
+    pthread_mutex_lock(&counterLock);
+    counterSet->taken = false;
+    pthread_mutex_unlock(&counterLock);
+    counterSet = NULL;
+}
+
+void sumCounters(unsigned long long* totals)
+{
+    for (int kind = 0; kind < COUNTER_COUNT; ++kind)
+        totals[kind] = 0;
+    // the sets are only linked in under the lock, and never unlinked
+    pthread_mutex_lock(&counterLock);
+    for (const CounterSet* set = counterSets; set != NULL; set = set->next)
+        for (int kind = 0; kind < COUNTER_COUNT; ++kind)
+            totals[kind] += LOAD_RELAXED(&set->values[kind]);
+    pthread_mutex_unlock(&counterLock);
+}
+
+const char* getCounterName(const CounterKind kind)
+{
+    // the descriptions of the counters, in the order of the enum
+    static const char* const names[COUNTER_COUNT] = {
+        "Tree nodes visited by search", "Tree nodes visited by level order", "Tree nodes visited by insert",
+        "String comparisons in owner lookups", "String comparisons in owner sorting", "Allocations", "Frees",
+        "Bytes read", "Bytes written"
+    };
+    return names[kind];
+}
+
+void printCounters(void)
+{
+    unsigned long long totals[COUNTER_COUNT];
+    sumCounters(totals);
+    printOutput("=== Counters ===\n");
+    for (int kind = 0; kind < COUNTER_COUNT; ++kind)
+        printOutput("%s: %llu\n", getCounterName(kind), totals[kind]);
+}
+
+void dumpCountersAtExit(void)
+{
+    // the dump goes to stderr, so it never mixes with the output of the commands
+    const char* enabled = getenv("EX6_STATS");
+    if (enabled == NULL || enabled[0] == '\0')
+        return;
+    unsigned long long totals[COUNTER_COUNT];
+    sumCounters(totals);
+    fprintf(stderr, "=== Counters ===\n");
+    for (int kind = 0; kind < COUNTER_COUNT; ++kind)
+        fprintf(stderr, "%s: %llu\n", getCounterName(kind), totals[kind]);
+}
+
+void enterEpoch(void)
+{
+    // the first read of a thread takes a record (one of a finished thread, or a new one)
+    if (epochRecord == NULL)
+    {
+        pthread_mutex_lock(&epochLock);
+        for (EpochRecord* record = epochRecords; record != NULL && epochRecord == NULL; record = record->next)
+            if (!record->taken)
+                epochRecord = record;
+        if (epochRecord == NULL)
+        {
+            epochRecord = malloc(sizeof(EpochRecord));
+            // if the allocation has failed, exit the program
+            if (epochRecord == NULL)
+            {
+                printOutput("Memory allocation failed. (enterEpoch: epochRecord)\n");
+                exit(1);
+            }
+            epochRecord->state = 0;
+            epochRecord->next = epochRecords;
+            epochRecords = epochRecord;
+        }
+        epochRecord->taken = true;
+        pthread_mutex_unlock(&epochLock);
+    }
+    // announce the current epoch, and make sure it still is the current one once announced
+    unsigned long epoch;
+    do
+    {
+        epoch = LOAD_ACQUIRE(&globalEpoch);
+        __atomic_store_n(&epochRecord->state, (epoch << 1) | 1, __ATOMIC_SEQ_CST);
+    } while (__atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST) != epoch);
+}
+
+void leaveEpoch(void)
+{
+    // the thread no longer holds the epoch back
+    STORE_RELEASE(&epochRecord->state, 0);
+}
+
+void releaseEpochRecord(void)
+{
+    // if the thread never read lock-free, it has no record
+    if (epochRecord == NULL)
+        return;
+    // the record is free for the next thread
+    pthread_mutex_lock(&epochLock);
+    epochRecord->taken = false;
+    pthread_mutex_unlock(&epochLock);
+    epochRecord = NULL;
+}
+
+void retireObject(const RetiredKind kind, void* object)
+{
+    RetiredObject retired = {kind, object};
+    // without lock-free readers, nobody else can see the object
+    if (!lockFreeReads)
+    {
+        reclaimObject(&retired);
+        return;
+    }
+    // add the object to the list of the current epoch (growing it, at least doubling it)
+    pthread_mutex_lock(&epochLock);
+    LimboList* list = &limbo[globalEpoch % EPOCH_LISTS];
+    if (list->count == list->capacity)
+    {
+        const int capacity = list->capacity > 0 ? list->capacity * 2 : DEFAULT_CAPACITY;
+        RetiredObject* objects = realloc(list->objects, capacity * sizeof(RetiredObject));
+        // if the allocation has failed, exit the program
+        if (objects == NULL)
+        {
+            printOutput("Memory reallocation failed. (retireObject: objects)\n");
+            exit(1);
+        }
+        list->objects = objects;
+        list->capacity = capacity;
+    }
+    list->objects[list->count++] = retired;
+    // move on if the readers let it, which frees what was retired before
+    advanceEpoch();
+    pthread_mutex_unlock(&epochLock);
+}
+
+bool advanceEpoch(void)
+{
+    // every reader must be in the current epoch (or not reading at all)
+    const unsigned long epoch = globalEpoch;
+    for (const EpochRecord* record = epochRecords; record != NULL; record = record->next)
+    {
+        const unsigned long state = __atomic_load_n(&record->state, __ATOMIC_SEQ_CST);
+        if ((state & 1) && (state >> 1) != epoch)
+            return false;
+    }
+    __atomic_store_n(&globalEpoch, epoch + 1, __ATOMIC_SEQ_CST);
+    // the objects retired two epochs ago were unreachable before any reader of now came in
+    LimboList* list = &limbo[(epoch + 1) % EPOCH_LISTS];
+    for (int i = 0; i < list->count; ++i)
+        reclaimObject(&list->objects[i]);
+    list->count = 0;
+    return true;
+}
+
+void reclaimObject(const RetiredObject* retired)
+{
+    // give the object back to where it came from
+    switch (retired->kind)
+    {
+    case RETIRED_TREE:
+        freePokemonTree(retired->object);
+        break;
+    case RETIRED_VERSION:
+        freePoolObject(&versionPool, retired->object);
+        break;
+    case RETIRED_OWNER:
+    {
+        OwnerNode* owner = retired->object;
+        free(owner->ownerName);
+        pthread_rwlock_destroy(&owner->lock);
+        freePoolObject(&ownerPool, owner);
+        break;
+    }
+    case RETIRED_INDEX:
+        free(retired->object);
+        break;
+    }
+}
+
+void synchronizeEpochs(void)
+{
+    // after as many moves as there are lists, every list was freed (the readers that are still in are waited for)
+    pthread_mutex_lock(&epochLock);
+    for (int moves = 0; moves < EPOCH_LISTS;)
+    {
+        if (advanceEpoch())
+            moves++;
+        else
+        {
+            pthread_mutex_unlock(&epochLock);
+            sched_yield();
+            pthread_mutex_lock(&epochLock);
+        }
+    }
+    // free the lists themselves
+    for (int i = 0; i < EPOCH_LISTS; ++i)
+    {
+        free(limbo[i].objects);
+        limbo[i].objects = NULL;
+        limbo[i].capacity = 0;
+    }
+    pthread_mutex_unlock(&epochLock);
+}
+
+PokemonNode* clonePokemonTree(const PokemonNode* root)
+{
+    // if the root is NULL, there is nothing to copy
+    if (root == NULL)
+        return NULL;
+    // copy the node (with its data and aggregates), then its subtrees
+    PokemonNode* copy = allocPoolObject(&pokemonPool);
+    *copy = *root;
+    copy->left = clonePokemonTree(root->left);
+    copy->right = clonePokemonTree(root->right);
+    return copy;
+}
+
+void beginPokedexChange(OwnerNode* owner)
+{
+    // outside lock-free mode, writers change the Pokedex in place,
+    // and a writer that already has its copy (its BST is not the published one) keeps changing it
+    if (!lockFreeReads || owner->published == NULL || owner->pokedexRoot != owner->published->root)
+        return;
+    // the writer works on a copy, the published version stays as it is until the copy is published
+    owner->pokedexRoot = clonePokemonTree(owner->pokedexRoot);
+}
+
+void publishPokedex(OwnerNode* owner)
+{
+    // outside lock-free mode, there is nothing to publish
+    if (!lockFreeReads)
+        return;
+    // if the command changed nothing, the published version is still the current one
+    PokedexVersion* old = owner->published;
+    if (old != NULL && old->root == owner->pokedexRoot
+        && memcmp(old->species, owner->species, sizeof(old->species)) == 0)
+        return;
+    // make the new version, and publish it in one store
+    PokedexVersion* version = allocPoolObject(&versionPool);
+    version->root = owner->pokedexRoot;
+    memcpy(version->species, owner->species, sizeof(version->species));
+    STORE_RELEASE(&owner->published, version);
+    // the old version (and its BST, if the new version has another one) is freed once no reader is in it
+    if (old == NULL)
+        return;
+    if (old->root != NULL && old->root != version->root)
+        retireObject(RETIRED_TREE, old->root);
+    retireObject(RETIRED_VERSION, old);
+}
+
+OwnerNode* readPublishedOwner(const OwnerNode* owner, OwnerNode* view)
+{
+    // the stand-in has the name of the owner, and the BST and bitmap of its published version
+    const PokedexVersion* version = LOAD_ACQUIRE(&owner->published);
+    memset(view, 0, sizeof(*view));
+    view->ownerName = owner->ownerName;
+    view->pokedexRoot = version->root;
+    memcpy(view->species, version->species, sizeof(view->species));
+    return view;
+}
+
+void retireOwner(OwnerNode* owner)
+{
+    // the published version first (its BST is the one readers may be in), then the owner with its name
+    if (owner->published != NULL)
+    {
+        if (owner->published->root != NULL)
+            retireObject(RETIRED_TREE, owner->published->root);
+        retireObject(RETIRED_VERSION, owner->published);
+    }
+    retireObject(RETIRED_OWNER, owner);
+}
@@ -1,10 +1,31 @@
 #ifndef EX6_H
 #define EX6_H
 
+// POSIX functions (write, ...) are used on top of C99
+#define _POSIX_C_SOURCE 200809L
+
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // boolean handling ************************************************************
 
@@ -20,6 +41,48 @@
 #define BULBASAUR           0
 #define CHARMANDER          3
 #define SQUIRTLE            6
+#define SPECIES_WORD_BITS   64
+#define SPECIES_WORDS       ((POKEDEX_LENGTH + SPECIES_WORD_BITS - 1) / SPECIES_WORD_BITS)
+#define SLAB_OBJECTS        256
+#define SPECIES_OWNERS_CAPACITY 8
+#define MERGE_OWNERS_PER_WORKER 64
+#define MERGE_MAX_WORKERS   16
+#define BATCH_MAX_ARGS      1024
+#define FIGHT_MAX_PAIRS     (BATCH_MAX_ARGS / 2)
+#define TYPE_COUNT          15
+#define SCORE_ATTACK_TENTHS 15
+#define SCORE_HP_TENTHS     12
+#define POKEMON_LINE_MAX    128
+#define OUTPUT_CAPACITY     65536
+#define INPUT_BLOCK         65536
+#define FNV_OFFSET_BASIS    2166136261u
+#define FNV_PRIME           16777619u
+#define SNAPSHOT_MAGIC      "EX6S"
+#define SNAPSHOT_VERSION    2u
+#define SNAPSHOT_KEEP_SORTED 1u
+#define SNAPSHOT_SPECIES_SIZE (SPECIES_WORDS * sizeof(unsigned long long))
+#define JOURNAL_MAGIC       "EX6J"
+#define JOURNAL_VERSION     2u
+#define JOURNAL_GROUP_BYTES 65536
+#define SERVER_BACKLOG      64
+#define SERVER_MAX_REQUEST  65536
+#define LOAD_CLIENTS        8
+#define LOAD_REQUESTS       10000
+#define BENCH_SEED          1
+#define BENCH_OWNERS        64
+#define BENCH_POKEMON       100
+#define BENCH_OPERATIONS    100000
+#define BENCH_MAX_WEIGHT    1000000
+
+#define EPOCH_LISTS         3
+
+// every thread has its own copy of the variable (C99 has no keyword for it, GCC and Clang do)
+#define THREAD_LOCAL        __thread
+// atomic loads and stores of the words lock-free readers share with writers (GCC and Clang builtins)
+#define LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define STORE_RELAXED(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
 
 // type definitions ************************************************************
 
@@ -58,14 +121,55 @@ typedef struct PokemonData
     EvolutionStatus CAN_EVOLVE;
 } PokemonData;
 
+// The pre-rendered display line of one species
+typedef struct PokemonLine
+{
+    char text[POKEMON_LINE_MAX];
+    int length;
+} PokemonLine;
+
+// Block-buffered (or memory-mapped) reader of the input lines
+typedef struct InputReader
+{
+    char* data; // the buffered bytes, or the mapping of the whole input
+    char* tail; // a copy of the last line of a mapping that does not end with a newline
+    size_t size; // the number of valid bytes in data
+    size_t capacity; // the size of data (when it is not a mapping)
+    size_t position; // where the next line starts
+    bool mapped; // if data is a mapping of the input file
+    bool ended; // if there is nothing more to read into data
+} InputReader;
+
+// Growable buffer that collects the output until it is flushed
+typedef struct OutputBuffer
+{
+    char* data;
+    size_t size;
+    size_t capacity;
+    int fd; // where the output is written (standard output, or the socket of a client)
+    bool framed; // if every flush is sent as one frame of the server protocol
+} OutputBuffer;
+
 // Binary Tree Node (for Pokedex)
 typedef struct PokemonNode
 {
     const PokemonData* data;
     struct PokemonNode* left;
     struct PokemonNode* right;
+    int height; // height of the subtree rooted at this node (a leaf is 1)
+    int size; // number of Pokemon in the subtree
+    int totalHP; // sum of the HP of the Pokemon in the subtree
+    const PokemonData* bestAttacker; // the Pokemon with the highest attack in the subtree (lowest ID on ties)
+    unsigned char typeCounts[TYPE_COUNT]; // number of Pokemon of every type in the subtree
 } PokemonNode;
 
+// A published (never changed) version of a Pokedex, which lock-free readers read instead of the owner
+typedef struct PokedexVersion
+{
+    PokemonNode* root; // the BST (its nodes are never changed once published)
+    unsigned long long species[SPECIES_WORDS]; // the species bitmap that goes with it
+} PokedexVersion;
+
 // Linked List Node (for Owners)
 typedef struct OwnerNode
 {
@@ -73,8 +177,69 @@ typedef struct OwnerNode
     PokemonNode* pokedexRoot; // Pointer to the root of the owner's Pokedex
     struct OwnerNode* next; // Next owner in the linked list
     struct OwnerNode* prev; // Previous owner in the linked list
+    unsigned long long species[SPECIES_WORDS]; // Bitmap of the species IDs in the Pokedex
+    int position; // Index of the owner in the owner table (0 is the head)
+    pthread_rwlock_t lock; // Shared by the commands that read the Pokedex, exclusive for the ones that change it
+    PokedexVersion* published; // The version lock-free readers see (NULL unless the server runs with --lockfree)
 } OwnerNode;
 
+// Contiguous table of the owners, in the same order as the linked list
+typedef struct OwnerTable
+{
+    OwnerNode** owners; // owners[i] is the i-th owner from the head (ownerCount of them)
+    int capacity;
+} OwnerTable;
+
+// One slot of the owner name index
+typedef struct OwnerIndexEntry
+{
+    OwnerNode* owner; // NULL if the slot was never used, &ownerTombstone if it was emptied
+    unsigned int hash; // hash of the owner's name
+} OwnerIndexEntry;
+
+// The slots of the owner name index, allocated (and published) together with their mask
+typedef struct OwnerIndexTable
+{
+    unsigned int mask; // the capacity - 1
+    OwnerIndexEntry entries[]; // the slots
+} OwnerIndexTable;
+
+// Open-addressing (linear probing) hash table from owner names to owners
+typedef struct OwnerIndex
+{
+    OwnerIndexTable* table; // the slots (NULL before the first owner)
+    int capacity; // always a power of two
+    int used; // live owners + tombstones
+} OwnerIndex;
+
+// Open-addressing (linear probing) hash set of the owners of one species
+typedef struct SpeciesOwners
+{
+    OwnerNode** owners; // the slots (NULL when empty, &ownerTombstone when emptied)
+    int capacity; // always a power of two (or 0 before the first owner)
+    int count; // live owners
+    int used; // live owners + tombstones
+} SpeciesOwners;
+
+// Fixed-size object pool (slabs of SLAB_OBJECTS objects + a free list)
+typedef struct ObjectPool
+{
+    size_t objectSize; // size of one object (at least one pointer)
+    void* slabs; // the newest slab, the first object slot of each slab links to the previous one
+    void* freeList; // recycled objects, each one links to the next
+    char* cursor; // the next never-used object in the newest slab
+    char* end; // the end of the newest slab
+    pthread_mutex_t lock; // guards the pool while the server changes owners from many threads
+} ObjectPool;
+
+// Pool objects chained up to be freed in one step (linked through their first word, like the free list)
+typedef struct PoolChain
+{
+    void* head; // the object chained last
+    void* tail; // the object chained first (it gets linked to the free list)
+    int count; // the number of objects in the chain
+} PoolChain;
+
 typedef struct NodeArray
 {
     PokemonNode** nodes;
@@ -82,18 +247,271 @@ typedef struct NodeArray
     int capacity;
 } NodeArray;
 
+// Ring-buffer queue of nodes (for level-order traversal)
+typedef struct PokemonQueue
+{
+    const PokemonNode** nodes;
+    int head; // index of the first node in the ring
+    int size;
+    int capacity;
+} PokemonQueue;
+
+// The header of a snapshot file, followed by ownerCount packed records of
+// {uint32_t nameLength, the name (no null char), the species bitmap}, all in the byte order of the machine
+typedef struct SnapshotHeader
+{
+    char magic[4]; // SNAPSHOT_MAGIC
+    uint32_t version; // SNAPSHOT_VERSION
+    uint32_t ownerCount; // the number of owner records
+    uint32_t flags; // SNAPSHOT_KEEP_SORTED if the owners were kept sorted
+    uint32_t generation; // the journal generation the snapshot is the base of
+} SnapshotHeader;
+
+// The kinds of changes the journal records
+typedef enum JournalRecordType
+{
+    JOURNAL_NEW = 1, // owner name, starter ID (0-based)
+    JOURNAL_ADD, // owner name, Pokemon ID
+    JOURNAL_RELEASE, // owner name, Pokemon ID
+    JOURNAL_EVOLVE, // owner name, Pokemon ID
+    JOURNAL_MERGE, // first owner name, second owner name
+    JOURNAL_DELETE, // owner name
+    JOURNAL_SORT, // no fields
+    JOURNAL_KEEP_SORTED, // no fields
+    JOURNAL_EVOLVE_ALL, // owner name
+    JOURNAL_MERGE_MANY // target owner name, count, that many owner names
+} JournalRecordType;
+
+// When the journal is made durable
+typedef enum FsyncPolicy
+{
+    FSYNC_ALWAYS, // after every record
+    FSYNC_BATCH, // once per group of records (before their results are shown)
+    FSYNC_NEVER // never, the system writes it back whenever it wants
+} FsyncPolicy;
+
+// The header of a journal file, followed by records of
+// {uint32_t bodyLength, uint32_t checksum, body: the type (1 byte), then the fields}
+// where names are null-terminated and IDs are int32_t, all in the byte order of the machine
+typedef struct JournalHeader
+{
+    char magic[4]; // JOURNAL_MAGIC
+    uint32_t version; // JOURNAL_VERSION
+    uint32_t generation; // must match the generation of the snapshot it is replayed on
+} JournalHeader;
+
+// The open journal, with the records that are not committed yet
+typedef struct Journal
+{
+    int fd; // the journal file (-1 if there is no journal)
+    char* snapshotPath; // the snapshot the journal is replayed on (the journal path + ".snap")
+    char* data; // the records waiting for the next commit
+    size_t size; // the number of bytes in data
+    size_t capacity; // the size of data
+    size_t recordStart; // where the record being written starts in data
+    uint32_t generation; // the current generation (bumped on every compaction)
+    FsyncPolicy policy; // when the journal is made durable
+    bool replaying; // if the journal is being replayed (so nothing is journaled)
+} Journal;
+
+// A cursor over the fields of a journal record
+typedef struct JournalReader
+{
+    const char* cursor; // the next field
+    const char* end; // the end of the record
+    bool valid; // if every field so far was inside the record
+} JournalReader;
+
+// One worker of a merge of many owners: it flattens a contiguous chunk of the owners
+typedef struct MergeWorker
+{
+    OwnerNode** owners; // the chunk, in merge order
+    int count; // the number of owners in the chunk
+    PokemonNode* kept[POKEDEX_LENGTH]; // the first node of every species in the chunk
+    PoolChain duplicates; // the other nodes, to be handed to the node pool at once
+    pthread_t thread; // the thread of the worker
+    bool started; // if the thread was started (else the chunk is flattened by the caller)
+} MergeWorker;
+
+// What a retired object is, so it can be freed once no reader can see it anymore
+typedef enum RetiredKind
+{
+    RETIRED_TREE, // a whole BST
+    RETIRED_VERSION, // a PokedexVersion
+    RETIRED_OWNER, // an OwnerNode (with its name)
+    RETIRED_INDEX // an OwnerIndexTable
+} RetiredKind;
+
+// An object that waits in a limbo list for the readers to leave
+typedef struct RetiredObject
+{
+    RetiredKind kind;
+    void* object;
+} RetiredObject;
+
+// The objects retired during one epoch
+typedef struct LimboList
+{
+    RetiredObject* objects;
+    int count;
+    int capacity;
+} LimboList;
+
+// The epoch a thread reads in, linked into the list of every thread's record
+typedef struct EpochRecord
+{
+    unsigned long state; // (the epoch << 1) | 1 while the thread reads, 0 while it does not
+    bool taken; // if a thread owns the record (records of finished threads are reused)
+    struct EpochRecord* next;
+} EpochRecord;
+
+// How a batch command locks the owners (the clients of the server run their commands at the same time)
+typedef enum CommandLock
+{
+    LOCK_SHARED, // shares the owners, and reads its owner (if it has one)
+    LOCK_OWNER, // shares the owners, and changes its owner
+    LOCK_EXCLUSIVE // adds, removes or reorders owners (or reads all of them at once)
+} CommandLock;
+
+// The hot-path counters (every thread counts on its own set, and the sets are summed when shown)
+typedef enum CounterKind
+{
+    COUNTER_SEARCH_NODES, // tree nodes visited by searchPokemonBFS
+    COUNTER_LEVEL_NODES, // tree nodes visited by BFSGeneric (level order)
+    COUNTER_INSERT_NODES, // tree nodes visited by insertPokemonNode
+    COUNTER_LOOKUP_COMPARES, // string comparisons in owner lookups
+    COUNTER_SORT_COMPARES, // string comparisons in sorting the owners
+    COUNTER_ALLOCATIONS, // pool objects allocated
+    COUNTER_FREES, // pool objects freed
+    COUNTER_BYTES_READ, // bytes read (or mapped) from files and sockets
+    COUNTER_BYTES_WRITTEN, // bytes written to files and sockets
+    COUNTER_COUNT
+} CounterKind;
+
+// The counters of one thread, linked into the list of every thread's set
+typedef struct CounterSet
+{
+    unsigned long long values[COUNTER_COUNT]; // only the thread that took the set writes them
+    bool taken; // if a thread owns the set (sets of finished threads are reused, counts and all)
+    struct CounterSet* next;
+} CounterSet;
+
+// One client of the load generator, which runs on a thread of its own
+typedef struct LoadClient
+{
+    const char* path; // the socket of the server
+    int index; // the number of the client (it names its owner and seeds its requests)
+    int requests; // the number of random requests to send
+    pthread_t thread; // the thread of the client
+    bool started; // if the thread was started
+    bool failed; // if the client could not connect, or lost the connection
+} LoadClient;
+
+// The operation types of the benchmark (BENCH_POPULATE creates and fills the owners, and is not part of the mix)
+typedef enum BenchOp
+{
+    BENCH_ADD,
+    BENCH_RELEASE,
+    BENCH_EVOLVE,
+    BENCH_FIGHT,
+    BENCH_DISPLAY,
+    BENCH_RANGE,
+    BENCH_STATS,
+    BENCH_SPECIES_OWNERS,
+    BENCH_MERGE,
+    BENCH_SORT,
+    BENCH_POPULATE,
+    BENCH_OP_COUNT
+} BenchOp;
+
+// How the benchmark picks the IDs of its commands
+typedef enum BenchIDs
+{
+    BENCH_IDS_UNIFORM, // every species as likely as the others
+    BENCH_IDS_SEQUENTIAL, // 1, 2, 3... for every owner (the worst order for a plain search tree)
+    BENCH_IDS_SKEWED // a few low IDs most of the time
+} BenchIDs;
+
+// The workload of the benchmark (the same config always generates the same commands)
+typedef struct BenchConfig
+{
+    int seed; // the seed of the generator
+    int owners; // the number of owners
+    int pokemon; // the number of IDs added to every owner before the mix starts
+    int operations; // the number of commands of the mix
+    int weights[BENCH_POPULATE]; // the share of every operation type in the mix
+    BenchIDs ids; // how the IDs are picked
+} BenchConfig;
+
+// The state of the workload generator
+typedef struct BenchGenerator
+{
+    BenchConfig config;
+    unsigned int seed; // the state of rand_r
+    int totalWeight; // the sum of the weights of the mix
+    int* nextIDs; // the number of sequential IDs every owner got so far
+    int building; // the owner being created and filled (-1 if none)
+    int added; // the IDs added to it so far (-1 until it is created)
+    bool initializing; // if the owners are still being built for the first time
+} BenchGenerator;
+
+// The latencies of one operation type, in nanoseconds
+typedef struct LatencyList
+{
+    long long* values;
+    int count;
+    int capacity;
+} LatencyList;
+
 typedef void (*PokemonNodeConsumer)(const PokemonNode*);
 
 // methods *********************************************************************
 
 /**
- * @brief Remove leading/trailing whitespace (including '\r').
+ * @brief Remove leading/trailing whitespace (including '\r'), in place.
  * @param str modifiable string
- * @return the trimmed string
+ * @return the trimmed string (a pointer into str, nothing is allocated)
  * Why we made it: We must handle CR/LF or random spaces in user input.
  */
 char* trim(char* str);
 
+/**
+ * @brief Map stdin if it is a regular file (else it is read in blocks).
+ * Why we made it: A mapped script is read with no copies and no read calls at all.
+ */
+void initInput(void);
+
+/**
+ * @brief Read another block of stdin into the input buffer, keeping the unfinished line.
+ */
+void fillInput(void);
+
+/**
+ * @brief Return the next input line, trimmed and null-terminated inside the input buffer.
+ * @return the line (valid until the next read), or NULL when the input has ended
+ * Why we made it: Lines are found with memchr and handed out without any allocation.
+ */
+char* readLine(void);
+
+/**
+ * @brief Flush the output, then return the next input line ("" when the input has ended).
+ * @return the line (valid until the next read)
+ * Why we made it: Prompts must be visible before we wait for an answer.
+ */
+char* getInputView(void);
+
+/**
+ * @brief Unmap or free the input buffer.
+ */
+void freeInput(void);
+
+/**
+ * @brief Copy a string into newly allocated memory.
+ * @param str the string
+ * @return the copy (caller frees)
+ */
+char* copyString(const char* str);
+
 /**
  * @brief Read an integer safely, re-prompt if invalid.
  * @param prompt text to display
@@ -103,11 +521,30 @@ char* trim(char* str);
 int readIntSafe(const char* prompt);
 
 /**
- * @brief Read a line from stdin, store in the allocated buffer, trim whitespace.
- * @return pointer to the newly allocated string (caller frees)
- * Why we made it: We need flexible name input that handles CR/LF etc.
+ * @brief Split a command line into words in place; "quoted words" may contain spaces.
+ * @param line the modifiable line
+ * @param args receives pointers to the words
+ * @param maxArgs the size of args
+ * @return the number of words
+ * Why we made it: Batch commands name owners, and owner names may contain spaces.
+ */
+int splitCommand(char* line, char** args, int maxArgs);
+
+/**
+ * @brief Parse a whole word as an integer.
+ * @param arg the word
+ * @param value receives the integer
+ * @return true if the word is a valid integer
+ */
+bool parseIntArg(const char* arg, int* value);
+
+/**
+ * @brief Parse a display mode word ("bfs", "pre", "in", "post", "alpha" or 1-5).
+ * @param arg the word
+ * @param choice receives the matching display menu option
+ * @return true if the word is valid
  */
-char* getDynamicInput(void);
+bool parseDisplayArg(const char* arg, int* choice);
 
 /**
  * @brief Return a string for a given PokemonType enum.
@@ -117,6 +554,51 @@ char* getDynamicInput(void);
  */
 const char* getTypeName(PokemonType type);
 
+/**
+ * @brief Render the display line of every species into pokemonLines.
+ * Why we made it: The Pokedex is static, so each line is formatted once and then just copied.
+ */
+void renderPokemonLines(void);
+
+/**
+ * @brief Fill alphabeticalIDs with the IDs of all the species, sorted by their names.
+ * Why we made it: The names are static, so they are compared once instead of on every display.
+ */
+void rankPokemonNames(void);
+
+/**
+ * @brief Make sure the output buffer has room for length more bytes.
+ * @param length the number of bytes
+ */
+void reserveOutput(size_t length);
+
+/**
+ * @brief Append raw bytes to the output buffer.
+ * @param data the bytes
+ * @param length the number of bytes
+ * Why we made it: Pre-rendered lines are copied with memcpy instead of formatted.
+ */
+void writeOutput(const char* data, size_t length);
+
+/**
+ * @brief printf into the output buffer.
+ * @param format the printf format
+ * Why we made it: Every message goes through the same buffer, so the order is kept.
+ */
+void printOutput(const char* format, ...);
+
+/**
+ * @brief Write the output buffer to stdout (usually in a single write) and empty it.
+ * Why we made it: One write per command instead of one stdio call per line.
+ */
+void flushOutput(void);
+
+/**
+ * @brief Flush and free the output buffer.
+ * Why we made it: Registered with atexit, so nothing is lost on exit.
+ */
+void freeOutput(void);
+
 /**
  * @brief Create a BST node with a copy of the given PokemonData.
  * @param data pointer to PokemonData (like from the global Pokedex)
@@ -125,6 +607,43 @@ const char* getTypeName(PokemonType type);
  */
 PokemonNode* createPokemonNode(const PokemonData* data);
 
+/**
+ * @brief Take one object from a pool, recycling a freed one if possible.
+ * @param pool pointer to the pool
+ * @return pointer to uninitialized memory of pool->objectSize bytes
+ * Why we made it: One malloc per slab instead of one per node.
+ */
+void* allocPoolObject(ObjectPool* pool);
+
+/**
+ * @brief Give an object back to its pool (it goes on the free list).
+ * @param pool pointer to the pool
+ * @param object the object to recycle
+ */
+void freePoolObject(ObjectPool* pool, void* object);
+
+/**
+ * @brief Add an object to a chain of objects that will be freed together.
+ * @param chain the chain
+ * @param object the object (its first word is overwritten, so it must not be read afterwards)
+ */
+void chainPoolObject(PoolChain* chain, void* object);
+
+/**
+ * @brief Give a whole chain of objects back to their pool in one step, and empty the chain.
+ * @param pool pointer to the pool
+ * @param chain the chain
+ * Why we made it: Freeing a tree (or the duplicates of a merge) costs one splice, not one free per node.
+ */
+void freePoolChain(ObjectPool* pool, PoolChain* chain);
+
+/**
+ * @brief Free every slab of a pool at once, invalidating all of its objects.
+ * @param pool pointer to the pool
+ * Why we made it: Tearing everything down is a handful of frees, not one per node.
+ */
+void releasePool(ObjectPool* pool);
+
 /**
  * @brief Create an OwnerNode for the circular owners list.
  * @param name the dynamically allocated name
@@ -134,6 +653,119 @@ PokemonNode* createPokemonNode(const PokemonData* data);
  */
 OwnerNode* createOwner(char* name, PokemonNode* starter);
 
+/**
+ * @brief Check whether an owner has a species, using the species bitmap.
+ * @param owner pointer to the owner
+ * @param id the (0-based) species ID, may be out of range
+ * @return true if the species is in the owner's Pokedex
+ * Why we made it: Duplicate and existence checks become a single bit test.
+ */
+bool hasSpecies(const OwnerNode* owner, int id);
+
+/**
+ * @brief Mark a species as owned in the owner's species bitmap.
+ * @param owner pointer to the owner
+ * @param id the (0-based) species ID
+ * Why we made it: Keeps the bitmap (and the species index) in sync whenever a node is inserted.
+ */
+void setSpecies(OwnerNode* owner, int id);
+
+/**
+ * @brief Replace the whole species bitmap of an owner, updating the species index for the bits that change.
+ * @param owner pointer to the owner
+ * @param species the new bitmap (SPECIES_WORDS words)
+ * Why we made it: Merges, loads and bulk evolutions change many bits at once.
+ */
+void replaceSpecies(OwnerNode* owner, const unsigned long long* species);
+
+/**
+ * @brief Hash an owner by its address.
+ * @param owner pointer to the owner
+ * @return the hash
+ */
+unsigned int hashOwnerPointer(const OwnerNode* owner);
+
+/**
+ * @brief Find the slot of an owner in a species set, or the empty slot where it would go.
+ * @param set the set (with a non-zero capacity)
+ * @param owner pointer to the owner
+ * @return the slot
+ */
+OwnerNode** findSpeciesOwnerSlot(const SpeciesOwners* set, const OwnerNode* owner);
+
+/**
+ * @brief Add an owner to the owners of a species (it must not be there yet).
+ * @param id the (0-based) species ID
+ * @param owner pointer to the owner
+ */
+void addSpeciesOwner(int id, OwnerNode* owner);
+
+/**
+ * @brief Remove an owner from the owners of a species (it must be there).
+ * @param id the (0-based) species ID
+ * @param owner pointer to the owner
+ */
+void removeSpeciesOwner(int id, const OwnerNode* owner);
+
+/**
+ * @brief Move a species set into a new number of slots, dropping its tombstones.
+ * @param set the set
+ * @param capacity the new capacity (a power of two, more than twice the owners in the set)
+ */
+void resizeSpeciesOwners(SpeciesOwners* set, int capacity);
+
+/**
+ * @brief Return how many owners have a species.
+ * @param id the (0-based) species ID
+ * @return the number of owners, in O(1)
+ * Why we made it: "How many trainers have X?" should not walk every owner.
+ */
+int countSpeciesOwners(int id);
+
+/**
+ * @brief Collect the owners of a species.
+ * @param id the (0-based) species ID
+ * @param owners where to store the owners (room for countSpeciesOwners(id) of them)
+ * @return the number of owners stored, in time proportional to it
+ * Why we made it: "Which trainers have X?" should not scan every Pokedex.
+ */
+int collectSpeciesOwners(int id, OwnerNode** owners);
+
+/**
+ * @brief Compare function for qsort (by the position of the owners in the list).
+ * @param a pointer to a pointer to OwnerNode
+ * @param b pointer to a pointer to OwnerNode
+ * @return -1, 0, or +1
+ */
+int compareOwnersByPosition(const void* a, const void* b);
+
+/**
+ * @brief Print how many owners have a species, and who they are (in the order of the list).
+ * @param id the (1-based) species ID
+ */
+void printSpeciesOwners(int id);
+
+/**
+ * @brief Free the owner sets of all the species.
+ */
+void freeSpeciesOwners(void);
+
+/**
+ * @brief Return the index of the lowest set bit of a non-zero bitmap word.
+ * @param bits the word (must not be 0)
+ * @return the index of the bit
+ * Why we made it: Walking the set bits of a bitmap skips the species an owner does not have.
+ */
+int lowestBit(unsigned long long bits);
+
+/**
+ * @brief Mark a species as not owned in the owner's species bitmap.
+ * @param owner pointer to the owner
+ * @param id the (0-based) species ID
+ * Why we made it: Keeps the bitmap (and the species index) in sync whenever a node is removed.
+ */
+void clearSpecies(OwnerNode* owner, int id);
+
 /**
  * @brief adds the OwnerNode to the circular owners list.
  * @param owner the pointer to the OwnerNode
@@ -141,16 +773,16 @@ OwnerNode* createOwner(char* name, PokemonNode* starter);
 void addOwner(OwnerNode* owner);
 
 /**
- * @brief Free one PokemonNode (including name).
+ * @brief Free one PokemonNode (back to the node pool).
  * @param node pointer to node
  * Why we made it: Avoid memory leaks for single nodes.
  */
 void freePokemonNode(PokemonNode* node);
 
 /**
- * @brief Recursively free a BST of PokemonNodes.
+ * @brief Free a BST of PokemonNodes by chaining all of them onto the pool's free list.
  * @param root BST root
- * Why we made it: Clearing a user’s entire Pokedex means freeing a tree.
+ * Why we made it: Clearing a user’s entire Pokedex means freeing a tree (no recursion, no free calls).
  */
 void freePokemonTree(PokemonNode* root);
 
@@ -159,9 +791,19 @@ void freePokemonTree(PokemonNode* root);
  * @param first the first PokemonNode
  * @param second the second PokemonNode
  * @return the merged Pokedex
+ * Why we made it: Flatten both, merge the sorted lists, rebuild balanced => O(n + m), no reallocation.
  */
 PokemonNode* mergeRoots(PokemonNode* first, PokemonNode* second);
 
+/**
+ * @brief Rebuild a perfectly balanced BST from nodes sorted by ID.
+ * @param nodes the nodes, sorted by ID without duplicates
+ * @param count the number of nodes
+ * @return the new BST root
+ * Why we made it: Merges relink the existing nodes instead of re-inserting them one by one.
+ */
+PokemonNode* buildBalancedTree(PokemonNode** nodes, int count);
+
 /**
  * @brief Free an OwnerNode (including name and entire Pokedex BST).
  * @param owner pointer to the owner
@@ -169,31 +811,117 @@ PokemonNode* mergeRoots(PokemonNode* first, PokemonNode* second);
  */
 void freeOwnerNode(OwnerNode* owner);
 
+/**
+ * @brief Return the height of a (possibly empty) AVL subtree.
+ * @param node subtree root or NULL
+ * @return 0 for NULL, the cached height otherwise
+ * Why we made it: NULL children count as height 0 in the balance math.
+ */
+int getPokemonHeight(const PokemonNode* node);
+
+/**
+ * @brief Return the number of Pokemon in a subtree.
+ * @param node the root of the subtree (may be NULL)
+ * @return the size, or 0 for an empty subtree
+ */
+int getPokemonSize(const PokemonNode* node);
+
+/**
+ * @brief Recompute the cached fields of a node (height and aggregates) from its children.
+ * @param node the node to update
+ * Why we made it: Every structural change must refresh the cached height and aggregates.
+ */
+void updatePokemonNode(PokemonNode* node);
+
+/**
+ * @brief Pick the better attacker of two Pokemon.
+ * @param a the first Pokemon
+ * @param b the second Pokemon
+ * @return the one with the higher attack (the lower ID on ties)
+ */
+const PokemonData* betterAttacker(const PokemonData* a, const PokemonData* b);
+
+/**
+ * @brief Give a node new data with the same place in the BST, refreshing the aggregates on its path.
+ * @param root the BST root (the ID must be in it)
+ * @param id the (0-based) ID of the node
+ * @param data the new data (its ID must keep the BST order)
+ * @return the root
+ */
+PokemonNode* repointPokemonNode(PokemonNode* root, int id, const PokemonData* data);
+
+/**
+ * @brief Recompute the cached fields of every node of a tree, bottom up.
+ * @param root the BST root
+ * Why we made it: A bulk repoint changes data all over the tree at once.
+ */
+void refreshPokemonTree(PokemonNode* root);
+
+/**
+ * @brief Print the count, total HP, best attacker and type histogram of a Pokedex.
+ * @param owner pointer to the Owner
+ * Why we made it: The aggregates of the root answer it in O(1), without walking the tree.
+ */
+void printPokedexStats(const OwnerNode* owner);
+
+/**
+ * @brief Rotate a subtree to the left (the right child becomes the root).
+ * @param root subtree root
+ * @return the new subtree root
+ * Why we made it: One of the two primitive AVL rebalancing steps.
+ */
+PokemonNode* rotateLeft(PokemonNode* root);
+
+/**
+ * @brief Rotate a subtree to the right (the left child becomes the root).
+ * @param root subtree root
+ * @return the new subtree root
+ * Why we made it: One of the two primitive AVL rebalancing steps.
+ */
+PokemonNode* rotateRight(PokemonNode* root);
+
+/**
+ * @brief Restore the AVL balance of a subtree whose children are balanced.
+ * @param root subtree root
+ * @return the new subtree root
+ * Why we made it: Keeps every Pokedex at O(log n) height after any change.
+ */
+PokemonNode* balancePokemonNode(PokemonNode* root);
+
+/**
+ * @brief Detach the node with the smallest ID from a subtree.
+ * @param root subtree root (not NULL)
+ * @param min receives the detached node
+ * @return the new (balanced) subtree root
+ * Why we made it: The in-order successor replaces a removed node with two children.
+ */
+PokemonNode* removeMinPokemonNode(PokemonNode* root, PokemonNode** min);
+
 /**
  * @brief Insert a PokemonNode into BST by ID; duplicates freed.
  * @param root pointer to BST root
  * @param node node to insert
  * @param handleDupe if true, handle duplicates
  * @return updated BST root
- * Why we made it: Standard BST insertion ignoring duplicates.
+ * Why we made it: Standard AVL insertion ignoring duplicates.
  */
 PokemonNode* insertPokemonNode(PokemonNode* root, PokemonNode* node, bool* handleDupe);
 
 /**
- * @brief BFS search for a Pokemon by ID in the BST.
+ * @brief Search for a Pokemon by ID in the BST (ordered descent).
  * @param root BST root
  * @param id ID to find
  * @return pointer to found node or NULL
- * Why we made it: BFS ensures we find nodes even in an unbalanced tree.
+ * Why we made it: The tree is balanced, so one root-to-leaf path is O(log n).
  */
 PokemonNode* searchPokemonBFS(PokemonNode* root, int id);
 
 /**
- * @brief Remove node from BST by ID if found (BST removal logic).
+ * @brief Remove node from BST by ID if found (AVL removal logic).
  * @param root BST root
  * @param id ID to remove
  * @return updated BST root
- * Why we made it: We handle special cases of a BST remove (0,1,2 children)
+ * Why we made it: We handle special cases of a BST remove (0,1,2 children) and rebalance.
  */
 PokemonNode* removeNodeBST(PokemonNode* root, int id);
 
@@ -206,23 +934,42 @@ PokemonNode* removeNodeBST(PokemonNode* root, int id);
  */
 PokemonNode* removePokemonByID(PokemonNode* root, int id);
 
-/**
- * @brief applying consumer on the given level of the BT
- * @param root BT root
- * @param level the level to print
- * @param consumer the consumer to apply
- * @return if the level is not empty
- */
-bool BTLevel(const PokemonNode* root, int level, PokemonNodeConsumer consumer);
-
 /**
  * @brief Generic BFS traversal: call consumer() on each node (level-order).
  * @param root BST root
  * @param consumer function pointer for what to do with each node
- * Why we made it: BFS plus function pointers => flexible traversal.
+ * Why we made it: BFS plus function pointers => flexible traversal, one pass with a queue.
  */
 void BFSGeneric(const PokemonNode* root, PokemonNodeConsumer consumer);
 
+/**
+ * @brief Make sure a PokemonQueue can hold at least cap nodes, keeping its contents.
+ * @param queue pointer to the queue
+ * @param cap the wanted capacity
+ * Why we made it: The queue is reused between traversals and only grows when needed.
+ */
+void reservePokemonQueue(PokemonQueue* queue, int cap);
+
+/**
+ * @brief Add a node to the back of the queue (grows it if full).
+ * @param queue pointer to the queue
+ * @param node the node to add
+ */
+void pushPokemonQueue(PokemonQueue* queue, const PokemonNode* node);
+
+/**
+ * @brief Remove the node at the front of the queue.
+ * @param queue pointer to the (non-empty) queue
+ * @return the removed node
+ */
+const PokemonNode* popPokemonQueue(PokemonQueue* queue);
+
+/**
+ * @brief Free the storage of a PokemonQueue and reset it to empty.
+ * @param queue pointer to the queue
+ */
+void freePokemonQueue(PokemonQueue* queue);
+
 /**
  * @brief A generic pre-order traversal (Root-Left-Right).
  * @param root BST root
@@ -239,6 +986,61 @@ void preOrderGeneric(const PokemonNode* root, PokemonNodeConsumer consumer);
  */
 void inOrderGeneric(const PokemonNode* root, PokemonNodeConsumer consumer);
 
+/**
+ * @brief An in-order traversal of only the nodes whose IDs are in a range.
+ * @param root BST root
+ * @param low the lowest (0-based) ID
+ * @param high the highest (0-based) ID
+ * @param consumer function pointer
+ * Why we made it: Subtrees outside the range are skipped, so it costs O(log n + output).
+ */
+void rangeGeneric(const PokemonNode* root, int low, int high, PokemonNodeConsumer consumer);
+
+/**
+ * @brief Find the k-th Pokemon by ID.
+ * @param root BST root
+ * @param k the 1-based position
+ * @return the node, or NULL if k is out of range
+ * Why we made it: The subtree sizes lead straight to it in O(log n).
+ */
+const PokemonNode* selectPokemon(const PokemonNode* root, int k);
+
+/**
+ * @brief Count the Pokemon with lower IDs than a given ID.
+ * @param root BST root
+ * @param id the (0-based) ID (it does not have to be in the tree)
+ * @return the number of lower IDs, in O(log n)
+ */
+int rankPokemon(const PokemonNode* root, int id);
+
+/**
+ * @brief Ask the user for an ID query (range, k-th or rank), and answer it.
+ * @param owner pointer to the Owner
+ */
+void queryPokemon(const OwnerNode* owner);
+
+/**
+ * @brief Print the Pokemon whose IDs are in a range, by ID.
+ * @param owner pointer to the Owner
+ * @param low the lowest (1-based) ID
+ * @param high the highest (1-based) ID
+ */
+void displayPokemonRange(const OwnerNode* owner, int low, int high);
+
+/**
+ * @brief Print the Pokemon with the k-th lowest ID.
+ * @param owner pointer to the Owner
+ * @param k the 1-based position
+ */
+void displayKthPokemon(const OwnerNode* owner, int k);
+
+/**
+ * @brief Print the position of a Pokemon by ID (or how many IDs are lower, if it is missing).
+ * @param owner pointer to the Owner
+ * @param id the (1-based) ID
+ */
+void displayPokemonRank(const OwnerNode* owner, int id);
+
 /**
  * @brief A generic post-order traversal (Left-Right-Root).
  * @param root BST root
@@ -271,32 +1073,51 @@ void initNodeArray(NodeArray *na, int cap);
 void addNode(NodeArray *na, PokemonNode *node);
 
 /**
- * @brief Recursively collect all nodes from the BST into a NodeArray.
+ * @brief Recursively collect all nodes from the BST into a NodeArray, sorted by ID.
  * @param root BST root
  * @param na pointer to NodeArray
- * Why we made it: We gather everything for qsort.
+ * Why we made it: An in-order flatten gives the sorted input of a linear merge.
  */
-void collectAll(PokemonNode *root, NodeArray *na);
+void collectInOrder(PokemonNode* root, NodeArray* na);
 
 /**
- * @brief Compare function for qsort (alphabetical by node->data->name).
- * @param a pointer to a pointer to PokemonNode
- * @param b pointer to a pointer to PokemonNode
- * @return -1, 0, or +1
- * Why we made it: Sorting by name for alphabetical display.
+ * @brief Fill typeMasks with the species bitmap of every type.
+ * Why we made it: The types are static, so an owner's bitmap ANDed with a mask is its index by type.
  */
-bool compareByNameNode(const void *a, const void *b);
+void buildTypeMasks(void);
 
 /**
- * @brief BFS is nice, but alphabetical means we gather all nodes, sort by name, then print.
- * @param root BST root
- * Why we made it: Provide user the option to see Pokemon sorted by name.
+ * @brief Add the species of a type to a mask, by the name of the type.
+ * @param name the name of the type (in any case)
+ * @param mask the mask (SPECIES_WORDS words)
+ * @return if the name is a type
  */
-void displayAlphabetical(PokemonNode *root);
+bool addTypeMask(const char* name, unsigned long long* mask);
 
 /**
- * @brief BFS user-friendly display (level-order).
- * @param root BST root
+ * @brief Ask the user for type names, and print the owner's Pokemon of those types.
+ * @param owner the owner
+ */
+void displayPokemonByTypesMenu(const OwnerNode* owner);
+
+/**
+ * @brief Print the Pokemon of an owner whose species are in a mask, by ID.
+ * @param owner the owner
+ * @param mask the species to print (SPECIES_WORDS words)
+ * Why we made it: A few word ANDs find the matches, so the cost scales with them and not with the Pokedex.
+ */
+void displayPokemonByTypes(const OwnerNode* owner, const unsigned long long* mask);
+
+/**
+ * @brief Print the Pokemon of an owner alphabetically, by walking the species in name order.
+ * @param owner the owner
+ * Why we made it: Provide user the option to see Pokemon sorted by name, in one pass and with no sorting.
+ */
+void displayAlphabetical(const OwnerNode* owner);
+
+/**
+ * @brief BFS user-friendly display (level-order).
+ * @param root BST root
  * Why we made it: Quick listing in BFS order.
  */
 void displayBFS(const PokemonNode *root);
@@ -337,7 +1158,7 @@ void pokemonFight(const OwnerNode *owner);
 void evolvePokemon(OwnerNode *owner);
 
 /**
- * @brief Prompt for an ID, BFS-check duplicates, then insert into BST.
+ * @brief Prompt for an ID, bitmap-check duplicates, then insert into BST.
  * @param owner pointer to the Owner
  * Why we made it: Primary user function for adding new Pokemon to an owner’s Pokedex.
  */
@@ -358,23 +1179,122 @@ void freePokemon(OwnerNode *owner);
 void displayPokemon(const OwnerNode* owner);
 
 /**
- * @brief Sort the circular owners list by name.
- * Why we made it: Another demonstration of pointer manipulation + sorting logic.
+ * @brief Display a Pokedex with the traversal of a display menu option.
+ * @param owner pointer to Owner
+ * @param choice the display menu option (1-5)
+ * Why we made it: The menu and batch mode share the same display code.
+ */
+void displayPokemonByChoice(const OwnerNode* owner, int choice);
+
+/**
+ * @brief Let two Pokemon of the same Pokedex fight, by their IDs.
+ * @param owner pointer to the Owner
+ * @param first the ID of the first Pokemon
+ * @param second the ID of the second Pokemon
+ */
+void fightPokemonByID(const OwnerNode* owner, int first, int second);
+
+/**
+ * @brief Evolve every Pokemon that can evolve in a Pokedex at once, merging away the duplicates.
+ * @param owner pointer to the Owner
+ * Why we made it: One in-order pass that just repoints the data, instead of a remove and an insert per Pokemon.
+ */
+void evolveAllPokemon(OwnerNode* owner);
+
+/**
+ * @brief Fill pokemonScores with the fight score of every species, in tenths.
+ * Why we made it: Integer scores are computed once, compare exactly, and pack well for SIMD.
+ */
+void computeFightScores(void);
+
+/**
+ * @brief Let many pairs of Pokemon of the same Pokedex fight, and report each fight like a single one.
+ * @param owner pointer to the Owner
+ * @param first the IDs of the first Pokemon of every pair
+ * @param second the IDs of the second Pokemon of every pair
+ * @param count the number of pairs (at most FIGHT_MAX_PAIRS)
+ * Why we made it: The scores are gathered into columns and all the fights are decided in one kernel call.
+ */
+void fightPokemonPairs(const OwnerNode* owner, const int* first, const int* second, int count);
+
+/**
+ * @brief Decide fights from packed score columns (SSE2 when available, else scalar).
+ * @param first the scores of the first side
+ * @param second the scores of the second side
+ * @param outcomes where to store 1 if the first wins, -1 if the second wins, or 0 on a tie
+ * @param count the number of fights
+ */
+void compareScores(const int* first, const int* second, signed char* outcomes, int count);
+
+/**
+ * @brief Count the wins and ties of every score against all the others (SSE2 when available, else scalar).
+ * @param scores the packed scores
+ * @param count the number of scores
+ * @param wins where to store the number of wins of every score
+ * @param ties where to store the number of ties of every score (not counting itself)
+ */
+void countRoundRobin(const int* scores, int count, int* wins, int* ties);
+
+/**
+ * @brief Let every Pokemon of a Pokedex fight every other one, and print the ranking.
+ * @param owner pointer to the Owner
+ * Why we made it: A whole tournament costs one pass of a vector kernel over the packed scores.
+ */
+void roundRobin(const OwnerNode* owner);
+
+/**
+ * @brief Evolve a Pokemon by its ID, if it is in the Pokedex and allowed to.
+ * @param owner pointer to the Owner
+ * @param choice the ID of the Pokemon
+ */
+void evolvePokemonByID(OwnerNode* owner, int choice);
+
+/**
+ * @brief Add a Pokemon by its ID, unless it is invalid or a duplicate.
+ * @param owner pointer to the Owner
+ * @param id the ID of the Pokemon
+ */
+void addPokemonByID(OwnerNode* owner, int id);
+
+/**
+ * @brief Release a Pokemon by its ID, if it is in the Pokedex.
+ * @param owner pointer to the Owner
+ * @param id the ID of the Pokemon
+ */
+void releasePokemonByID(OwnerNode* owner, int id);
+
+/**
+ * @brief Sort the circular owners list by name (merge sort that relinks the nodes).
+ * Why we made it: Another demonstration of pointer manipulation + sorting logic, in O(n log n).
  */
 void sortOwners(void);
 
 /**
- * @brief Helper to swap name & pokedexRoot in two OwnerNode.
- * @param a pointer to first owner
- * @param b pointer to second owner
- * Why we made it: Used internally by bubble sort to swap data.
+ * @brief Merge sort a NULL-terminated list of owners, linked through next only.
+ * @param head the first owner of the list
+ * @return the first owner of the sorted list
+ * Why we made it: sortOwners opens the ring, sorts it with this, then closes it again.
  */
-void swapOwnerData(OwnerNode* a, OwnerNode* b);
+OwnerNode* mergeSortOwners(OwnerNode* head);
+
+/**
+ * @brief Merge two sorted NULL-terminated lists of owners (linked through next).
+ * @param a the first sorted list
+ * @param b the second sorted list
+ * @return the first owner of the merged list
+ */
+OwnerNode* mergeOwnerLists(OwnerNode* a, OwnerNode* b);
+
+/**
+ * @brief Turn keeping the owners sorted on insert on or off.
+ * Why we made it: Once the ring is sorted and kept sorted, sorting again costs nothing.
+ */
+void toggleKeepOwnersSorted(void);
 
 /**
  * @brief Insert a new owner into the circular list. If none exist, it's alone.
  * @param newOwner pointer to newly created OwnerNode
- * Why we made it: We need a standard approach to keep the list circular.
+ * Why we made it: We need a standard approach to keep the list circular (and sorted, if asked to).
  */
 void linkOwnerInCircularList(OwnerNode* newOwner);
 
@@ -386,13 +1306,95 @@ void linkOwnerInCircularList(OwnerNode* newOwner);
 void removeOwnerFromCircularList(OwnerNode* target);
 
 /**
- * @brief Find an owner by name in the circular list.
+ * @brief Return the owner chosen by its menu number, in O(1).
+ * @param number the 1-based number shown in the menus
+ * @return the owner (numbers past the end wrap around the circle, numbers below 1 give the head)
+ * Why we made it: Selecting an owner by number should not chase pointers.
+ */
+OwnerNode* getOwnerByNumber(int number);
+
+/**
+ * @brief Print the numbered list of the owners ("1. name" lines).
+ * Why we made it: Both the Pokedex menu and the delete menu start with it.
+ */
+void printOwnerList(void);
+
+/**
+ * @brief Put an owner into the owner table at a position, shifting the ones after it.
+ * @param owner the owner
+ * @param position where to put it (0..ownerCount)
+ */
+void insertOwnerInTable(OwnerNode* owner, int position);
+
+/**
+ * @brief Take an owner out of the owner table, shifting the ones after it.
+ * @param owner the owner
+ */
+void removeOwnerFromTable(const OwnerNode* owner);
+
+/**
+ * @brief Refill the owner table by walking the linked list from the head.
+ * Why we made it: After the list is relinked (sorting), all the positions change at once.
+ */
+void rebuildOwnerTable(void);
+
+/**
+ * @brief Binary search the (sorted) owner table for the position of a name.
+ * @param name the name
+ * @return the position of the first owner whose name does not come before the given one
+ */
+int findSortedOwnerPosition(const char* name);
+
+/**
+ * @brief Find an owner by name using the owner name index.
  * @param name string to match
  * @return pointer to the matching OwnerNode or NULL
- * Why we made it: We often need to locate an owner quickly.
+ * Why we made it: We often need to locate an owner quickly (expected O(1)).
  */
 OwnerNode* findOwnerByName(const char* name);
 
+/**
+ * @brief FNV-1a hash of an owner name.
+ * @param name the name
+ * @return the hash
+ */
+unsigned int hashOwnerName(const char* name);
+
+/**
+ * @brief Find the index slot holding a name, or the empty slot that ends its probe sequence.
+ * @param name the name to look for
+ * @param hash the hash of the name
+ * @return pointer to the slot
+ * Why we made it: Lookup, insertion and removal share the same probing.
+ */
+OwnerIndexEntry* findOwnerIndexEntry(const char* name, unsigned int hash);
+
+/**
+ * @brief Find the probe position of a hash that is not in a table yet (the first empty slot).
+ * @param table the table
+ * @param hash the hash
+ * @return the index of the slot
+ */
+unsigned int findEmptyIndexSlot(const OwnerIndexTable* table, unsigned int hash);
+
+/**
+ * @brief Add an owner to the owner name index (grows the index if needed).
+ * @param owner the owner, whose name is not indexed yet
+ */
+void indexOwner(OwnerNode* owner);
+
+/**
+ * @brief Remove an owner from the owner name index (leaves a tombstone).
+ * @param owner the indexed owner
+ */
+void unindexOwner(OwnerNode* owner);
+
+/**
+ * @brief Rebuild the owner name index with the given capacity, dropping tombstones.
+ * @param capacity the new capacity (a power of two)
+ */
+void resizeOwnerIndex(int capacity);
+
 /**
  * @brief Let user pick an existing Pokedex (owner) by number, then sub-menu.
  * Why we made it: This is the main interface for adding/fighting/evolving, etc.
@@ -411,21 +1413,92 @@ void newPokedex(void);
  */
 void deletePokedex(void);
 
+/**
+ * @brief Return the starter Pokemon of a starter menu option.
+ * @param choice the option (1-3)
+ * @return the starter's data, or NULL if the option is invalid
+ */
+const PokemonData* getStarter(int choice);
+
+/**
+ * @brief Create a Pokedex for a new (unique) owner with a starter Pokemon.
+ * @param ownerName the dynamically allocated name, owned by the new owner
+ * @param starter the starter's data
+ */
+void createPokedex(char* ownerName, const PokemonData* starter);
+
+/**
+ * @brief Delete an owner and its entire Pokedex, informing the user.
+ * @param target pointer to the owner
+ */
+void deleteOwner(OwnerNode* target);
+
 /**
  * @brief Merge the second owner's Pokedex into the first, then remove the second owner.
  * Why we made it: BFS copy demonstration plus removing an owner.
  */
 void mergePokedexMenu(void);
 
+/**
+ * @brief Merge the second owner's Pokedex into the first owner's, then remove the second owner.
+ * @param firstOwner the owner that keeps both Pokedexes
+ * @param secondOwner the owner that is removed (an owner is never merged with itself)
+ */
+void mergeOwners(OwnerNode* firstOwner, OwnerNode* secondOwner);
+
+/**
+ * @brief Ask the user for an owner to merge into and the owners to absorb, and merge them.
+ */
+void mergeManyPokedexMenu(void);
+
+/**
+ * @brief Merge many owners into one: flatten their trees in parallel, reduce the chunks, and build one balanced BST.
+ * @param target the owner that keeps the result (its nodes win on duplicates, then the sources' in order)
+ * @param sources the owners to absorb (all different, and none of them the target)
+ * @param count the number of sources
+ * Why we made it: Consolidating hundreds of trainers should not take hundreds of two-way merges.
+ */
+void mergeManyOwners(OwnerNode* target, OwnerNode** sources, int count);
+
+/**
+ * @brief Flatten the trees of a chunk of owners into one node per species (a thread entry point).
+ * @param arg the MergeWorker
+ * @return NULL
+ */
+void* flattenOwnersWorker(void* arg);
+
+/**
+ * @brief Flatten one tree into a worker, keeping the first node of every species and chaining the rest.
+ * @param root BST root
+ * @param worker the worker
+ */
+void flattenPokemonTree(PokemonNode* root, MergeWorker* worker);
+
+/**
+ * @brief Remove many owners from the list, the table and the indexes, and free them, in one pass.
+ * @param owners the owners (all different)
+ * @param count the number of owners
+ * Why we made it: Removing owners one by one shifts the whole table every time.
+ */
+void removeOwners(OwnerNode** owners, int count);
+
 /**
  * @brief Print owners left or right from head, repeating as many times as user wants.
  * Why we made it: Demonstrates stepping through a circular list in a chosen direction.
  */
 void printOwnersCircular(void);
 
+/**
+ * @brief Print owners from the head in one direction, a given number of times.
+ * @param forward true to follow next, false to follow prev
+ * @param times how many owners to print
+ */
+void printOwnersInDirection(bool forward, int times);
+
 /**
  * @brief Frees every remaining owner in the circular list, setting ownerHead = NULL.
- * Why we made it: Ensures a squeaky-clean exit with no leftover memory.
+ * @param pPockdexes pointer to the head of the circular list
+ * Why we made it: Ensures a squeaky-clean exit with no leftover memory (slabs released in bulk).
  */
 void freePokdexes(OwnerNode** pPockdexes);
 
@@ -435,6 +1508,513 @@ void freePokdexes(OwnerNode** pPockdexes);
  */
 void mainMenu(void);
 
+/**
+ * @brief Run commands from the input, one per line, without prompts or menus.
+ * Why we made it: Scripted workloads only want the results, not the menu text.
+ */
+void runBatch(void);
+
+/**
+ * @brief Run one batch command line (e.g. "add Ash 25", "merge \"Officer Jenny\" Brook").
+ * @param line the modifiable line
+ */
+void runBatchCommand(char* line);
+
+/**
+ * @brief Find how a batch command locks the owners.
+ * @param command the name of the command
+ * @return LOCK_EXCLUSIVE, LOCK_OWNER or LOCK_SHARED
+ * Why we made it: Commands on different owners (and reads of the same owner) run in parallel in the server.
+ */
+CommandLock getCommandLock(const char* command);
+
+/**
+ * @brief Write a whole buffer to a file descriptor, retrying short and interrupted writes.
+ * @param fd the file descriptor
+ * @param data the bytes
+ * @param length the number of bytes
+ * @return if everything was written
+ */
+bool writeAll(int fd, const char* data, size_t length);
+
+/**
+ * @brief Make room in the owner table and the name index for a number of owners.
+ * @param count the number of owners
+ * Why we made it: A bulk load should not regrow and rehash a million times on the way.
+ */
+void reserveOwners(int count);
+
+/**
+ * @brief Save every owner (name and species bitmap) into a binary snapshot file.
+ * @param path the snapshot file (replaced atomically through a temporary file)
+ * @return if the snapshot was saved
+ * Why we made it: Restarting should not mean replaying the whole input again.
+ */
+bool saveSnapshot(const char* path);
+
+/**
+ * @brief Fsync the directory a file is in.
+ * @param path the file
+ * @return if the directory was synced
+ * Why we made it: A rename is only durable once the directory that holds the new entry is synced.
+ */
+bool syncParentDirectory(const char* path);
+
+/**
+ * @brief Check that a snapshot is complete and valid, before anything is built from it.
+ * @param data the snapshot bytes
+ * @param size the number of bytes
+ * @return NULL if it is valid, else a short description of the problem
+ */
+const char* checkSnapshot(const char* data, size_t size);
+
+/**
+ * @brief Replace all the owners with the ones in a snapshot file.
+ * @param path the snapshot file
+ * @param generation where to store the journal generation of the snapshot (may be NULL)
+ * @return if the snapshot was loaded (on failure, the current owners are kept)
+ * Why we made it: The file is mapped and every BST is built balanced straight from its bitmap, with no replay.
+ */
+bool loadSnapshot(const char* path, uint32_t* generation);
+
+/**
+ * @brief Load a snapshot on user request, and make it the new base of the journal (if there is one).
+ *        If the journal cannot be compacted after the load, the program exits, since the journal
+ *        would bring the old owners back on the next start.
+ * @param path the snapshot file
+ */
+void loadSnapshotCommand(const char* path);
+
+/**
+ * @brief Parse the name of an fsync policy (always, batch or never).
+ * @param arg the name
+ * @param policy where to store the policy
+ * @return if the name is valid
+ */
+bool parseFsyncPolicy(const char* arg, FsyncPolicy* policy);
+
+/**
+ * @brief Return if changes should be journaled now.
+ * @return if a journal is open and is not being replayed
+ */
+bool isJournaling(void);
+
+/**
+ * @brief Make room for more bytes in the journal buffer.
+ * @param length the number of bytes
+ */
+void reserveJournal(size_t length);
+
+/**
+ * @brief Start a journal record (its length and checksum are filled in by endJournalRecord).
+ * @param type the type of the record
+ */
+void beginJournalRecord(JournalRecordType type);
+
+/**
+ * @brief Add a name field to the current journal record.
+ * @param name the name
+ */
+void writeJournalName(const char* name);
+
+/**
+ * @brief Add an integer field to the current journal record.
+ * @param value the integer
+ */
+void writeJournalInt(int value);
+
+/**
+ * @brief Finish the current journal record, and commit if the policy or the group size says so.
+ * Why we made it: Committing a group of records at once spreads the cost of a write and an fsync over all of them.
+ */
+void endJournalRecord(void);
+
+/**
+ * @brief Journal a change with the fields its type uses (if changes are journaled at all).
+ * @param type the type of the change
+ * @param name the owner name (unused by JOURNAL_SORT and JOURNAL_KEEP_SORTED)
+ * @param value the ID (used by JOURNAL_NEW, JOURNAL_ADD, JOURNAL_RELEASE and JOURNAL_EVOLVE)
+ */
+void journalOwnerChange(JournalRecordType type, const char* name, int value);
+
+/**
+ * @brief Compute the checksum of a journal record body.
+ * @param body the body
+ * @param length the length of the body
+ * @return the FNV-1a hash of the body
+ * Why we made it: A record torn by a crash must not be replayed as if it were whole.
+ */
+unsigned int checksumJournalRecord(const char* body, size_t length);
+
+/**
+ * @brief Write the waiting journal records, and make them durable by the fsync policy.
+ * Why we made it: It runs before every output flush, so no result is shown before its change is journaled.
+ */
+void commitJournal(void);
+
+/**
+ * @brief Empty the journal file, leaving just a header of the current generation.
+ * @return if it succeeded
+ */
+bool resetJournalFile(void);
+
+/**
+ * @brief Load the journal's snapshot (if any), replay the journal on top of it, and keep it open for appending.
+ * @param path the journal file
+ * @param policy the fsync policy
+ * @return if the journal is open
+ * Why we made it: A crash loses nothing that was journaled since the last snapshot.
+ */
+bool openJournal(const char* path, FsyncPolicy policy);
+
+/**
+ * @brief Redo every valid record of a journal, with their output discarded.
+ *        A record that does not apply to the current owners is reported and skipped;
+ *        only a torn or damaged record (bad length or checksum) ends the replay.
+ * @param data the journal bytes
+ * @param size the number of bytes
+ * @return the offset right after the last intact record
+ */
+size_t replayJournal(const char* data, size_t size);
+
+/**
+ * @brief Read a name field of a journal record.
+ * @param reader the cursor
+ * @return the name (inside the record), or "" if the record is too short
+ */
+const char* readJournalName(JournalReader* reader);
+
+/**
+ * @brief Read an integer field of a journal record.
+ * @param reader the cursor
+ * @return the integer, or 0 if the record is too short
+ */
+int readJournalInt(JournalReader* reader);
+
+/**
+ * @brief Redo the change of a single journal record.
+ * @param body the body of the record
+ * @param length the length of the body
+ * @return if the record is valid and applies to the current owners
+ */
+bool applyJournalRecord(const char* body, size_t length);
+
+/**
+ * @brief Save a snapshot of the next generation next to the journal, and empty the journal.
+ * @return if the journal was compacted (else the journal and its snapshot are left as they were)
+ * Why we made it: Keeps the journal (and the replay at startup) short.
+ */
+bool compactJournal(void);
+
+/**
+ * @brief Commit and close the journal, and free its buffers.
+ */
+void closeJournal(void);
+
+/**
+ * @brief Read a whole buffer from a file descriptor, retrying short and interrupted reads.
+ * @param fd the file descriptor
+ * @param data the buffer
+ * @param length the number of bytes to read
+ * @return true if all of them were read, false at the end of the stream or on an error
+ */
+bool readAll(int fd, char* data, size_t length);
+
+/**
+ * @brief Write one frame of the server protocol: a uint32_t length, then the bytes.
+ * @param fd the socket
+ * @param data the bytes
+ * @param length the number of bytes (0 ends the results of a request)
+ * @return true on success, false on an error
+ */
+bool writeFrame(int fd, const char* data, uint32_t length);
+
+/**
+ * @brief Read one frame of the server protocol into a growable buffer, and end it with a null char.
+ * @param fd the socket
+ * @param data the buffer (grown as needed)
+ * @param capacity the size of the buffer
+ * @param length the length of the frame
+ * @param maxLength the longest frame that is accepted
+ * @return true on success, false at the end of the stream, on an error or on a frame that is too long
+ */
+bool readFrame(int fd, char** data, size_t* capacity, uint32_t* length, uint32_t maxLength);
+
+/**
+ * @brief Fill the address of a Unix domain socket.
+ * @param path the path of the socket
+ * @param address the address to fill
+ * @return true on success, false if the path is too long
+ */
+bool makeSocketAddress(const char* path, struct sockaddr_un* address);
+
+/**
+ * @brief Stop the server (the handler of SIGINT and SIGTERM).
+ * @param signal the signal
+ */
+void stopServer(int signal);
+
+/**
+ * @brief Serve batch commands to many clients over a Unix domain socket, until SIGINT or SIGTERM.
+ * @param path the path of the socket
+ * @return true if the server ran, false if it could not listen
+ * Why we made it: Many operators (or scripts) work on the same owners at once.
+ */
+bool runServer(const char* path);
+
+/**
+ * @brief Run the requests of one client, each one a batch command (a thread entry point).
+ * @param arg the socket of the client
+ * @return NULL
+ */
+void* serveClient(void* arg);
+
+/**
+ * @brief Connect to a server.
+ * @param path the path of its socket
+ * @return the socket, or -1 on an error
+ */
+int connectToServer(const char* path);
+
+/**
+ * @brief Send one command to the server and read its results.
+ * @param server the socket
+ * @param command the batch command
+ * @param reply the buffer for the results (grown as needed)
+ * @param capacity the size of the buffer
+ * @param show if the results are printed
+ * @return true on success, false if the connection was lost
+ */
+bool sendRequest(int server, const char* command, char** reply, size_t* capacity, bool show);
+
+/**
+ * @brief Send every line of the input to a server as a command, and print the results.
+ * @param path the path of the socket of the server
+ * @return true on success, false if the connection failed or was lost
+ */
+bool runClient(const char* path);
+
+/**
+ * @brief Load a server with many clients that send random commands, and report the throughput.
+ * @param path the path of the socket of the server
+ * @param clients the number of clients (one thread each)
+ * @param requests the number of random requests of every client
+ * @return true if every client got through
+ * Why we made it: The locking of the server can only be tested (and measured) under load.
+ */
+bool runLoadClients(const char* path, int clients, int requests);
+
+/**
+ * @brief Run one client of the load generator (a thread entry point).
+ * @param arg the LoadClient
+ * @return NULL
+ */
+void* runLoadClient(void* arg);
+
+/**
+ * @brief Set the default workload of the benchmark.
+ * @param config the config to fill
+ */
+void initBenchConfig(BenchConfig* config);
+
+/**
+ * @brief Parse the mix of the benchmark, like "add=30,display=20,merge=1".
+ * @param arg the mix
+ * @param weights the weight of every operation type (the ones not listed get 0)
+ * @return true if the mix is valid and not empty
+ */
+bool parseBenchMix(const char* arg, int* weights);
+
+/**
+ * @brief Parse the ID distribution of the benchmark (uniform, sequential or skewed).
+ * @param arg the name of the distribution
+ * @param ids the distribution
+ * @return true if the name is valid
+ */
+bool parseBenchIDs(const char* arg, BenchIDs* ids);
+
+/**
+ * @brief Get the name of an operation type of the benchmark.
+ * @param op the operation type
+ * @return the name (as used in the mix)
+ */
+const char* getBenchOpName(BenchOp op);
+
+/**
+ * @brief Pick the next ID for an owner, by the distribution of the workload.
+ * @param generator the workload generator
+ * @param owner the number of the owner
+ * @return the ID (1 to POKEDEX_LENGTH)
+ */
+int nextBenchID(BenchGenerator* generator, int owner);
+
+/**
+ * @brief Generate the next batch command of the workload.
+ * @param generator the workload generator
+ * @param line the buffer for the command
+ * @param size the size of the buffer
+ * @return the operation type of the command
+ * Why we made it: The commands depend on nothing but the config, so every run (and every script) is the same.
+ */
+BenchOp nextBenchCommand(BenchGenerator* generator, char* line, size_t size);
+
+/**
+ * @brief Run a generated workload, and report the throughput and the latencies of every operation type.
+ * @param config the workload
+ * @param script if the commands are printed (as a batch script) instead of run
+ * Why we made it: The 83 lines of input.txt cannot show how sorting, merging or BFS behave at scale.
+ */
+void runBenchmark(const BenchConfig* config, bool script);
+
+/**
+ * @brief Add a latency to a list (grown as needed).
+ * @param list the list
+ * @param nanoseconds the latency
+ */
+void recordLatency(LatencyList* list, long long nanoseconds);
+
+/**
+ * @brief Compare two latencies (for qsort).
+ * @param a the first latency
+ * @param b the second latency
+ * @return negative, zero or positive, like strcmp
+ */
+int compareLatencies(const void* a, const void* b);
+
+/**
+ * @brief Find a percentile of a sorted, non-empty list of latencies (nearest rank).
+ * @param list the list
+ * @param perMille the percentile, in tenths of a percent (990 is p99)
+ * @return the latency, in nanoseconds
+ */
+long long latencyPercentile(const LatencyList* list, int perMille);
+
+/**
+ * @brief Add to a counter of the thread (taking a set of counters on its first count).
+ * @param kind the counter
+ * @param amount the amount to add
+ * Why we made it: A plain add to the thread's own set is cheap enough to leave on all the time.
+ */
+void addCounter(CounterKind kind, unsigned long long amount);
+
+/**
+ * @brief Take a set of counters for the thread (a released one if there is any, else a new one).
+ */
+void takeCounterSet(void);
+
+/**
+ * @brief Give the set of counters of a finishing thread back, so another thread can count on it.
+ */
+void releaseCounterSet(void);
+
+/**
+ * @brief Sum the counters of every thread.
+ * @param totals the sums (COUNTER_COUNT of them)
+ */
+void sumCounters(unsigned long long* totals);
+
+/**
+ * @brief Get the description of a counter.
+ * @param kind the counter
+ * @return the description
+ */
+const char* getCounterName(CounterKind kind);
+
+/**
+ * @brief Print the sums of the counters.
+ */
+void printCounters(void);
+
+/**
+ * @brief Print the sums of the counters to stderr if EX6_STATS is set (an atexit handler).
+ */
+void dumpCountersAtExit(void);
+
+/**
+ * @brief Find if a batch command works on a single owner (its first argument).
+ * @param command the name of the command
+ * @return true if it does
+ */
+bool takesOwner(const char* command);
+
+/**
+ * @brief Start reading in the current epoch (registers the thread on its first read).
+ * Why we made it: Lock-free readers announce the epoch they read in, so nothing they can see is freed under them.
+ */
+void enterEpoch(void);
+
+/**
+ * @brief Stop reading, so the epoch can move on.
+ */
+void leaveEpoch(void);
+
+/**
+ * @brief Give the epoch record of the thread back (when the thread ends).
+ */
+void releaseEpochRecord(void);
+
+/**
+ * @brief Free an object once no reader can see it anymore (right away unless readers are lock-free).
+ * @param kind what the object is
+ * @param object the object, already unreachable for new readers
+ */
+void retireObject(RetiredKind kind, void* object);
+
+/**
+ * @brief Move to the next epoch if every reader is in the current one, and free what was retired two epochs ago.
+ * @return true if the epoch moved on
+ */
+bool advanceEpoch(void);
+
+/**
+ * @brief Free a retired object.
+ * @param retired the object and its kind
+ */
+void reclaimObject(const RetiredObject* retired);
+
+/**
+ * @brief Wait until every reader left, and free everything that was retired.
+ * Why we made it: The owners can only be freed all at once (on load and at exit) after the readers are gone.
+ */
+void synchronizeEpochs(void);
+
+/**
+ * @brief Copy a BST node by node.
+ * @param root BST root
+ * @return the root of the copy
+ */
+PokemonNode* clonePokemonTree(const PokemonNode* root);
+
+/**
+ * @brief Give a writer a private copy of a Pokedex, so the published version stays as it is (lock-free mode only).
+ *        Called right before the first change of a command; later calls find the copy and do nothing.
+ * @param owner the owner that is about to change
+ * Why we made it: A Pokedex has at most 151 nodes, so a copy costs about as much as a few path copies,
+ *                 and every AVL, evolve and merge routine works on it unchanged.
+ */
+void beginPokedexChange(OwnerNode* owner);
+
+/**
+ * @brief Publish the Pokedex of an owner as a new version, and retire the old version (lock-free mode only).
+ *        Nothing is published if the BST and the bitmap are still the published ones.
+ * @param owner the owner
+ */
+void publishPokedex(OwnerNode* owner);
+
+/**
+ * @brief Give a lock-free reader a stand-in owner with the published version of the Pokedex.
+ * @param owner the owner
+ * @param view the stand-in to fill
+ * @return the stand-in
+ */
+OwnerNode* readPublishedOwner(const OwnerNode* owner, OwnerNode* view);
+
+/**
+ * @brief Retire the published version of a removed owner, then the owner itself.
+ * @param owner the owner, already out of the name index
+ */
+void retireOwner(OwnerNode* owner);
+
 // data ************************************************************************
 
 static const PokemonData pokedex[] = {
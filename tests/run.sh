@@ -0,0 +1,83 @@
+#!/bin/sh
+# Run the golden tests against a built ex6: every batch/NAME.txt is run with --batch and must print batch/NAME.out.
+# Usage: tests/run.sh [path to ex6]   (the default is ./ex6)
+# After a change that is meant to alter the output, refresh the golden file with ./ex6 --batch < batch/NAME.txt > batch/NAME.out
+
+tests=$(cd "$(dirname "$0")" && pwd)
+EX6=$(cd "$(dirname "${1:-./ex6}")" && pwd)/$(basename "${1:-./ex6}")
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+failed=0
+
+# compare an output with its golden file, and show the difference if they differ
+check()
+{
+    if diff -u "$2" "$3" > "$scratch/diff"; then
+        echo "PASS $1"
+    else
+        echo "FAIL $1"
+        cat "$scratch/diff"
+        failed=1
+    fi
+}
+
+# every batch script runs in an empty directory, since some of them write files
+for script in "$tests"/batch/*.txt; do
+    name=$(basename "$script" .txt)
+    rm -rf "$scratch/run" && mkdir "$scratch/run"
+    (cd "$scratch/run" && "$EX6" --batch < "$script") > "$scratch/$name.out" 2>&1
+    check "$name" "$tests/batch/$name.out" "$scratch/$name.out"
+done
+
+# the journal: a crash tears the last record, and the next start drops only that one
+# (a record that does not apply to the owners it is replayed on is reported and skipped, not cut off)
+rm -rf "$scratch/run" && mkdir "$scratch/run"
+(
+    cd "$scratch/run" || exit 1
+    echo "== changes"
+    "$EX6" --batch --journal j.log --fsync always < "$tests/journal/changes.txt"
+    truncate -s -3 j.log
+    echo "== replay after a torn record"
+    "$EX6" --batch --journal j.log < "$tests/journal/check.txt"
+    echo "== replay again"
+    "$EX6" --batch --journal j.log < "$tests/journal/check.txt"
+    echo "== conflicting base snapshot"
+    "$EX6" --batch < "$tests/journal/conflict.txt"
+    "$EX6" --batch --journal j.log < "$tests/journal/check.txt"
+    echo "== compact"
+    echo compact | "$EX6" --batch --journal j.log
+    "$EX6" --batch --journal j.log < "$tests/journal/check.txt"
+) > "$scratch/journal.out" 2>&1
+check journal "$tests/journal/expected.out" "$scratch/journal.out"
+
+# the server: every request gets the answer --batch gives, with and without lock-free reads
+# (and it says goodbye when it is stopped)
+{ "$EX6" --batch < "$tests/server/commands.txt" 2>&1; echo "Server stopped."; } > "$scratch/expected.out"
+for flags in "" "--lockfree"; do
+    rm -f "$scratch/ex6.sock"
+    "$EX6" --server "$scratch/ex6.sock" $flags > "$scratch/server.out" 2>&1 &
+    server=$!
+    # wait (up to 5 seconds) for the server to listen
+    tries=0
+    while [ ! -S "$scratch/ex6.sock" ] && [ $tries -lt 50 ]; do
+        sleep 0.1
+        tries=$((tries + 1))
+    done
+    "$EX6" --client "$scratch/ex6.sock" < "$tests/server/commands.txt" > "$scratch/client.out" 2>&1
+    # the server must stop cleanly on SIGTERM
+    kill -TERM $server
+    wait $server || echo "The server exited with status $?." >> "$scratch/client.out"
+    tail -n 1 "$scratch/server.out" >> "$scratch/client.out"
+    check "server $flags" "$scratch/expected.out" "$scratch/client.out"
+done
+
+# the benchmark: the same seed always generates the same script, which runs in batch mode like any other
+(cd "$scratch" && "$EX6" --bench --script --seed 7 --owners 3 --pokemon 5 --ops 30) > "$scratch/seed7.txt" 2>&1
+check "bench script" "$tests/bench/seed7.txt" "$scratch/seed7.txt"
+(cd "$scratch" && "$EX6" --batch < "$tests/bench/seed7.txt") > "$scratch/seed7.out" 2>&1
+check "bench batch" "$tests/bench/seed7.out" "$scratch/seed7.out"
+(cd "$scratch" && "$EX6" --bench --seed 7 --owners 3 --pokemon 5 --ops 30 | head -n 1) > "$scratch/report.out" 2>&1
+echo "Benchmark: seed 7, 3 owners, 5 Pokemon each, 30 operations, uniform IDs." > "$scratch/report.expected"
+check "bench report" "$scratch/report.expected" "$scratch/report.out"
+
+exit $failed